@@ -1,4 +1,3 @@
-#include <assert.h>
 #include "addressing.h"
 
 // Address = Xn + uoffset
@@ -13,9 +12,7 @@ uint64_t get_address_unsigned_immediate(ARMState* state, uint64_t imm12, uint8_t
         uoffset = (uint64_t)imm12 << 3;
     } // Cast is just for clarity
 
-    assert(register_xn <= 30);
-    // Ensures that xn is a valid register index
-
+    // Register 31 is the PC slot, as for the other addressing modes
     base_address = state->registers[register_xn];
     target_address = base_address + uoffset;
     return target_address;
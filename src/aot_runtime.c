@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aot_runtime.h"
+#include "decode_cache.h"
+#include "device_bus.h"
+#include "gpio.h"
+#include "block_engine.h"
+#include "state_io.h"
+
+int aot_main(int argc, char** argv, const char* image_name, const uint8_t* image, size_t image_size,
+             AotProgram program) {
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [file_out]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Translations check addresses against MEMORY_SIZE, so the runtime uses that size
+    ARMState arm_state;
+    if (!initialize_arm_state(&arm_state, MEMORY_SIZE)) {
+        return EXIT_FAILURE;
+    }
+    size_t bytes_loaded = image_size < MEMORY_SIZE ? image_size : MEMORY_SIZE;
+    memcpy(arm_state.memory, image, bytes_loaded);
+    mark_dirty_range(&arm_state, 0, bytes_loaded);
+    fprintf(stderr, "Loaded %zu bytes from '%s' into memory.\n", bytes_loaded, image_name);
+
+    DeviceBus devices;
+    Gpio gpio;
+    device_bus_init(&devices);
+    gpio_attach(&gpio, &devices);
+    attach_device_bus(&arm_state, &devices);
+
+    FILE* output_file = stdout;
+    if (argc == 2) {
+        output_file = fopen(argv[1], "w");
+        if (!output_file) {
+            fprintf(stderr, "Error: Could not open output file '%s'\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    DecodeCache* decode_cache = decode_cache_create(arm_state.memory_size);
+    if (!decode_cache) {
+        return EXIT_FAILURE;
+    }
+    arm_state.decode_cache = decode_cache;
+
+    fprintf(stderr, "Starting emulation...\n");
+    program(&arm_state);
+    // The interpreter picks up where the translation stopped, HALT included
+    run_blocks(&arm_state, decode_cache);
+    fprintf(stderr, "Emulation finished.\n");
+
+    print_final_state(&arm_state, output_file);
+
+    arm_state.decode_cache = NULL;
+    decode_cache_free(decode_cache);
+    free_arm_state(&arm_state);
+
+    if (output_file != stdout) {
+        fclose(output_file);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,54 @@
+#ifndef AOT_RUNTIME_H
+#define AOT_RUNTIME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "arm_state.h"
+#include "constants.h"
+
+// Support code for images translated ahead of time by `translate`. A translated
+// image is a C file holding the image bytes and one function that runs its
+// statically reachable code natively; it is linked against this runtime and the
+// interpreter, which takes over for anything the translation leaves out.
+
+// Runs the translated code from state->pc. Returns with the guest registers and
+// flags written back and state->pc at the first instruction it did not execute.
+typedef void (*AotProgram)(ARMState* state);
+
+// main() of a translated image: `<program> [file_out]`. Loads the embedded image,
+// runs the translation, lets the interpreter finish the run and prints the final
+// state exactly like emulate does for image_name.
+int aot_main(int argc, char** argv, const char* image_name, const uint8_t* image, size_t image_size,
+             AotProgram program);
+
+// Little-endian guest memory accesses
+static inline uint32_t aot_load32(const uint8_t* p) {
+    return load_le32(p);
+}
+
+static inline uint64_t aot_load64(const uint8_t* p) {
+    return load_le64(p);
+}
+
+// Stores go to an address already checked against MEMORY_SIZE
+static inline void aot_store32(ARMState* state, uint64_t address, uint32_t value) {
+    store_le32(state->memory + address, value);
+    mark_dirty(state, address, 4);
+}
+
+static inline void aot_store64(ARMState* state, uint64_t address, uint64_t value) {
+    store_le64(state->memory + address, value);
+    mark_dirty(state, address, 8);
+}
+
+// Does a store of width bytes at address overwrite a translated instruction?
+// code_map has one bit per instruction word of the image.
+static inline bool aot_touches_code(const uint8_t* code_map, size_t code_words, uint64_t address, unsigned width) {
+    for (uint64_t word = address >> 2; word <= (address + width - 1) >> 2; word++) {
+        if (word < code_words && ((code_map[word >> 3] >> (word & 7)) & 1)) return true;
+    }
+    return false;
+}
+
+#endif
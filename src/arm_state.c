@@ -1,45 +1,82 @@
+#include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
+#include <sys/mman.h>
 #include "arm_state.h"
 
-void initialize_arm_state(ARMState* state) {
-    // Set all registers to 0
+bool initialize_arm_state(ARMState* state, uint64_t memory_size) {
+    // Set all registers to 0, which also sets PC to 0 and clears the zero slot
     memset(state->registers, 0, sizeof(state->registers));
 
-    // Set PC to 0
-    state->pc = 0;
+    // Fresh anonymous pages read as 0, so nothing is touched here: startup costs the
+    // same for any memory size
+    state->memory = mmap(NULL, memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                         -1, 0);
+    if (state->memory == MAP_FAILED) {
+        perror("Failed to map guest memory");
+        state->memory = NULL;
+        state->memory_size = 0;
+        return false;
+    }
+    state->memory_size = memory_size;
+
+    state->dirty_pages = calloc(memory_size >> MEMORY_PAGE_SHIFT, 1);
+    if (!state->dirty_pages) {
+        perror("Failed to allocate the dirty page map");
+        munmap(state->memory, memory_size);
+        state->memory = NULL;
+        state->memory_size = 0;
+        return false;
+    }
 
-    // Set memory to 0
-    memset(state->memory, 0, sizeof(state->memory));
+    // No decode cache, devices or cache model until the emulator attaches them
+    state->decode_cache = NULL;
+    state->devices = NULL;
+    state->ram_end = memory_size;
+#ifdef CACHE_SIM_ENABLED
+    state->cache_sim = NULL;
+#endif
 
     // Initialize PSTATE flags
-    state->pstate.N = false;
-    state->pstate.Z = true; // Z flag is set on startup
-    state->pstate.C = false;
-    state->pstate.V = false;
+    state->nzcv = FLAG_Z; // Z flag is set on startup
+    memset(&state->last_flag_op, 0, sizeof(state->last_flag_op)); // FLAGS_NONE
+    return true;
 }
 
-uint32_t read_word_from_memory(ARMState* state, uint32_t address) {
-    if (address + 3 >= sizeof(state->memory)) {
-        fprintf(stderr, "Error: Memory access out of bounds at 0x%x\n", address);
-        return 0; 
+void free_arm_state(ARMState* state) {
+    if (state->memory != NULL) {
+        munmap(state->memory, state->memory_size);
     }
+    free(state->dirty_pages);
+    state->dirty_pages = NULL;
+    state->memory = NULL;
+    state->memory_size = 0;
+    state->ram_end = 0;
+}
 
-    // A64 instructions are little-endian
-    return (uint32_t)state->memory[address] |
-           (uint32_t)state->memory[address + 1] << 8 |
-           (uint32_t)state->memory[address + 2] << 16 |
-           (uint32_t)state->memory[address + 3] << 24;
+uint64_t memory_fault(const ARMState* state, uint64_t address, unsigned width) {
+    fprintf(stderr, "Error: Memory access out of bounds at 0x%" PRIx64 " (%u bytes, PC 0x%016" PRIx64 ")\n",
+            address, width, state->pc);
+    return 0;
+}
+
+uint32_t read_word_from_memory(ARMState* state, uint32_t address) {
+    if (!in_guest_memory(state, address, 4)) return (uint32_t)memory_fault(state, address, 4);
+    return load_le32(&state->memory[address]);
 }
 
 void write_word_to_memory(ARMState* state, uint32_t address, uint32_t value) {
-    if (address + 3 >= sizeof(state->memory)) {
-        fprintf(stderr, "Error: Memory access out of bounds at 0x%x\n", address);
+    if (!in_guest_memory(state, address, 4)) {
+        memory_fault(state, address, 4);
         return;
     }
+    store_le32(&state->memory[address], value);
+    mark_dirty(state, address, 4);
+}
 
-    // Convert to Little Endian using masking
-    state->memory[address] = (uint8_t)(value & 0xFF);
-    state->memory[address + 1] = (uint8_t)((value >> 8) & 0xFF);
-    state->memory[address + 2] = (uint8_t)((value >> 16) & 0xFF);
-    state->memory[address + 3] = (uint8_t)((value >> 24) & 0xFF);
-}
\ No newline at end of file
+void mark_dirty_range(ARMState* state, uint64_t address, uint64_t length) {
+    if (length == 0) return;
+    uint64_t first = address >> MEMORY_PAGE_SHIFT;
+    uint64_t last = (address + length - 1) >> MEMORY_PAGE_SHIFT;
+    memset(&state->dirty_pages[first], 1, last - first + 1);
+}
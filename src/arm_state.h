@@ -4,27 +4,187 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "constants.h"
 
+// Predecoded instruction cache attached to a running machine (see decode_cache.h)
+typedef struct DecodeCache DecodeCache;
+
+// Memory-mapped devices of a running machine (see device_bus.h)
+typedef struct DeviceBus DeviceBus;
+
+// Cache hierarchy model fed by a running machine (see cache_sim.h)
+typedef struct CacheSim CacheSim;
+
+// Register file slots. Loads, stores and BR name the PC as register 31, and it
+// lives in slot 31. Data processing instead reads register 31 as zero and
+// discards writes to it: register_read_slot and register_write_slot send it to
+// the two extra slots below, so neither needs a branch.
+#define REGISTER_PC    31
+#define REGISTER_ZERO  32 // Always 0
+#define REGISTER_SINK  33 // Written, never read
+#define REGISTER_SLOTS 34
+
+// PSTATE flags, packed into one NZCV nibble
+#define FLAG_N 0x8 // Negative
+#define FLAG_Z 0x4 // Zero
+#define FLAG_C 0x2 // Carry
+#define FLAG_V 0x1 // Overflow
+
 // ARMv8 machine state
 typedef struct {
-    uint64_t registers[31]; // X0-X30 general-purpose registers
-    uint64_t pc;            // Program Counter
+    // Hot state comes first, apart from memory: the flags and the decode cache
+    // pointer share the first cache line, and the register file follows it.
 
-    // Processor State Register (PSTATE) flags
+    // Last flag-setting operation whose flags are not in nzcv yet. They are only
+    // computed when something reads them (see materialize_flags in dp_executor.h).
     struct {
-        bool N; // Negative
-        bool Z; // Zero
-        bool C; // Carry
-        bool V; // Overflow
-    } pstate;
-
-    // 2MB byte-addressable memory
-    uint8_t memory[MEMORY_SIZE]; 
+        uint64_t result, op1, op2;
+        uint8_t kind; // FlagUpdate (FLAGS_NONE: nzcv is up to date)
+        bool sf;
+    } last_flag_op;
+
+    uint8_t nzcv; // Processor State Register (PSTATE) flags, FLAG_N | FLAG_Z | FLAG_C | FLAG_V
+
+    // Cache notified of stores so self-modifying code is re-decoded (NULL: none)
+    DecodeCache* decode_cache;
+
+    union {
+        uint64_t registers[REGISTER_SLOTS];
+        struct {
+            uint64_t x[31]; // X0-X30 general-purpose registers
+            uint64_t pc;    // Program Counter (slot REGISTER_PC)
+        };
+    };
+
+    // Byte-addressable guest memory [0, memory_size). It is one anonymous mapping
+    // reserved up front: the host allocates (zeroed) pages only when they are first
+    // written, and reads of untouched pages all share the zero page.
+    uint8_t* memory;
+    uint64_t memory_size;
+
+    // One byte per memory page, set once the page is loaded or written. Pages never
+    // marked are still all zero, so the final dump only scans marked ones.
+    uint8_t* dirty_pages;
+
+    // Loads and stores that end at or below ram_end are plain RAM. It is memory_size
+    // lowered to the first device of the bus, if that lies inside RAM; only accesses
+    // past it look the device up (NULL: no devices, ram_end == memory_size).
+    uint64_t ram_end;
+    DeviceBus* devices;
+
+#ifdef CACHE_SIM_ENABLED
+    CacheSim* cache_sim; // Sees every fetch, load and store (NULL: not simulating)
+#endif
 } ARMState;
 
+// Slot data processing reads register reg (0-31) from
+static inline unsigned register_read_slot(uint8_t reg) {
+    return reg + (reg == 31); // 31 -> REGISTER_ZERO
+}
+
+// Slot data processing writes register reg (0-31) to
+static inline unsigned register_write_slot(uint8_t reg) {
+    return reg + 2 * (reg == 31); // 31 -> REGISTER_SINK
+}
+
+// --- Guest memory access ---
+// Guest memory is little-endian. Each accessor below does one range check and one
+// (possibly unaligned) host load or store of its width; accesses past ram_end take
+// the device bus path instead.
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define GUEST_ORDER32(value) __builtin_bswap32(value)
+#define GUEST_ORDER64(value) __builtin_bswap64(value)
+#else
+#define GUEST_ORDER32(value) (value)
+#define GUEST_ORDER64(value) (value)
+#endif
+
+static inline uint32_t load_le32(const uint8_t* bytes) {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return GUEST_ORDER32(value);
+}
+
+static inline uint64_t load_le64(const uint8_t* bytes) {
+    uint64_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return GUEST_ORDER64(value);
+}
+
+static inline void store_le32(uint8_t* bytes, uint32_t value) {
+    value = GUEST_ORDER32(value);
+    memcpy(bytes, &value, sizeof(value));
+}
+
+static inline void store_le64(uint8_t* bytes, uint64_t value) {
+    value = GUEST_ORDER64(value);
+    memcpy(bytes, &value, sizeof(value));
+}
+
+// Does [address, address + width) lie in guest memory? memory_size is a whole
+// number of pages, so it never underflows.
+static inline bool in_guest_memory(const ARMState* state, uint64_t address, unsigned width) {
+    return address <= state->memory_size - width;
+}
+
+// Marks the pages of a store of width bytes at address (in guest memory) dirty; an
+// unaligned store may straddle two
+static inline void mark_dirty(ARMState* state, uint64_t address, unsigned width) {
+    state->dirty_pages[address >> MEMORY_PAGE_SHIFT] = 1;
+    state->dirty_pages[(address + width - 1) >> MEMORY_PAGE_SHIFT] = 1;
+}
+
+// Marks the pages of [address, address + length) in guest memory dirty
+void mark_dirty_range(ARMState* state, uint64_t address, uint64_t length);
+
+// Is [address, address + width) plain RAM, with no device in the way? ram_end is
+// at least a page (devices never claim page 0), so it never underflows either.
+static inline bool in_plain_ram(const ARMState* state, uint64_t address, unsigned width) {
+    return address <= state->ram_end - width;
+}
+
+// Reports an access outside guest memory; loads that fault read 0 and stores that
+// fault are dropped, so host memory is never touched
+uint64_t memory_fault(const ARMState* state, uint64_t address, unsigned width);
+
+// Accesses past ram_end: a device's handler, RAM behind the first device, or a
+// fault, also for an access that crosses into or out of a device (see device_bus.c). The store returns true only if it wrote RAM.
+uint64_t memory_read_slow(const ARMState* state, uint64_t address, unsigned width);
+bool memory_write_slow(ARMState* state, uint64_t address, unsigned width, uint64_t value);
+
+static inline uint32_t memory_read32(const ARMState* state, uint64_t address) {
+    if (!in_plain_ram(state, address, 4)) return (uint32_t)memory_read_slow(state, address, 4);
+    return load_le32(&state->memory[address]);
+}
+
+static inline uint64_t memory_read64(const ARMState* state, uint64_t address) {
+    if (!in_plain_ram(state, address, 8)) return memory_read_slow(state, address, 8);
+    return load_le64(&state->memory[address]);
+}
+
+// Return false if the store did not write RAM (it faulted, or went to a device)
+static inline bool memory_write32(ARMState* state, uint64_t address, uint32_t value) {
+    if (!in_plain_ram(state, address, 4)) return memory_write_slow(state, address, 4, value);
+    store_le32(&state->memory[address], value);
+    mark_dirty(state, address, 4);
+    return true;
+}
+
+static inline bool memory_write64(ARMState* state, uint64_t address, uint64_t value) {
+    if (!in_plain_ram(state, address, 8)) return memory_write_slow(state, address, 8, value);
+    store_le64(&state->memory[address], value);
+    mark_dirty(state, address, 8);
+    return true;
+}
+
 // Common functions
-void initialize_arm_state(ARMState* state);
+// Resets state and maps memory_size bytes (a multiple of MEMORY_PAGE_SIZE, at most
+// MAX_MEMORY_SIZE) of zeroed memory; returns false if the mapping fails
+bool initialize_arm_state(ARMState* state, uint64_t memory_size);
+void free_arm_state(ARMState* state);
+// RAM only, whatever devices are attached: for loading images and dumping state
 uint32_t read_word_from_memory(ARMState* state, uint32_t address);
 void write_word_to_memory(ARMState* state, uint32_t address, uint32_t value);
 
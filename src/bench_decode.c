@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "decoder.h"
+#include "decoder_reference.h"
+
+// Decoder throughput benchmark: ./bench_decode [image]
+// Decodes the words of image (or, without one, a synthetic mix of every format)
+// over and over with the reference decoder, with decode_instruction and with
+// decode_block, and reports instructions per second for each.
+
+#define SYNTHETIC_WORDS (1U << 16)
+#define MIN_DECODES (64U << 20)
+
+typedef DecodedInstruction (*Decoder)(uint32_t instruction_word);
+
+static uint32_t next_random(uint32_t* seed) {
+    // xorshift32
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+// A program-like mix: mostly data processing, then loads/stores and branches
+static uint32_t synthetic_word(uint32_t* seed) {
+    uint32_t w = next_random(seed);
+    uint32_t kind = next_random(seed) % 100;
+    if (kind < 30) return (w & ~(0x7U << 26)) | (0x4U << 26);             // DP_IMM: op0 100x
+    if (kind < 60) return (w & ~(0x7U << 25)) | (0x5U << 25);             // DP_REG: op0 x101
+    if (kind < 85) return ((w | 1U << 27) & ~(1U << 25)) | 1U << 31;      // SDT: op0 x1x0
+    if (kind < 90) return ((w | 1U << 27) & ~(1U << 25 | 1U << 31));      // LL
+    uint32_t groups[3] = { 0x0, 0x1, 0x3 };                               // B, B.cond, BR
+    w = (w & ~(0x7U << 26)) | (0x5U << 26);                               // BRANCH: op0 101x
+    return (w & ~(0x3U << 30)) | groups[kind % 3] << 30;
+}
+
+static double seconds_now(void) { // CPU time: immune to other load on the host
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Returns decodes per second; *checksum keeps the results live
+static double measure(Decoder decode, const uint32_t* words, size_t count, uint32_t rounds, uint32_t* checksum) {
+    double start = seconds_now();
+    for (uint32_t round = 0; round < rounds; round++) {
+        for (size_t k = 0; k < count; k++) {
+            DecodedInstruction instr = decode(words[k]);
+            *checksum += instr.type + instr.dp_reg.rd + instr.dp_reg.rn;
+        }
+    }
+    return (double)count * rounds / (seconds_now() - start);
+}
+
+static double measure_block(const uint32_t* words, size_t count, uint32_t rounds, uint32_t* checksum) {
+    DecodedInstruction* decoded = malloc(count * sizeof(DecodedInstruction));
+    if (!decoded) return 0;
+    double start = seconds_now();
+    for (uint32_t round = 0; round < rounds; round++) {
+        decode_block(words, count, decoded);
+        *checksum += decoded[round % count].type + decoded[round % count].dp_reg.rd;
+    }
+    double elapsed = seconds_now() - start;
+    free(decoded);
+    return (double)count * rounds / elapsed;
+}
+
+static uint32_t* load_words(const char* path, size_t* count) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open file '%s'\n", path);
+        return NULL;
+    }
+    uint32_t* words = malloc(MEMORY_SIZE);
+    if (!words) {
+        fclose(file);
+        return NULL;
+    }
+    // Words are little-endian, like the host this is built for
+    *count = fread(words, sizeof(uint32_t), MEMORY_SIZE / sizeof(uint32_t), file);
+    fclose(file);
+    return words;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [image]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    size_t count = SYNTHETIC_WORDS;
+    uint32_t* words;
+    if (argc == 2) {
+        words = load_words(argv[1], &count);
+        if (!words) return EXIT_FAILURE;
+        if (count == 0) {
+            fprintf(stderr, "Error: '%s' holds no instruction words\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+    } else {
+        words = malloc(count * sizeof(uint32_t));
+        if (!words) return EXIT_FAILURE;
+        uint32_t seed = 0x2545F491;
+        for (size_t k = 0; k < count; k++) words[k] = synthetic_word(&seed);
+    }
+
+    // The decoders must agree before their speed means anything
+    DecodedInstruction* bulk = malloc(count * sizeof(DecodedInstruction));
+    if (!bulk) return EXIT_FAILURE;
+    decode_block(words, count, bulk);
+    for (size_t k = 0; k < count; k++) {
+        DecodedInstruction expected = decode_instruction_reference(words[k]);
+        DecodedInstruction actual = decode_instruction(words[k]);
+        if (memcmp(&expected, &actual, sizeof(DecodedInstruction)) != 0 ||
+            memcmp(&expected, &bulk[k], sizeof(DecodedInstruction)) != 0) {
+            fprintf(stderr, "Error: Decoders disagree on 0x%08x\n", words[k]);
+            return EXIT_FAILURE;
+        }
+    }
+    free(bulk);
+
+    uint32_t rounds = (uint32_t)((MIN_DECODES + count - 1) / count);
+    uint32_t checksum = 0;
+    double reference = measure(decode_instruction_reference, words, count, rounds, &checksum);
+    double table = measure(decode_instruction, words, count, rounds, &checksum);
+    double block = measure_block(words, count, rounds, &checksum);
+
+    printf("Decoded %zu words x %u rounds (checksum %08x)\n", count, rounds, checksum);
+    printf("reference decoder:    %8.1f M instructions/s\n", reference / 1e6);
+    printf("table-driven decoder: %8.1f M instructions/s (%.2fx)\n", table / 1e6, table / reference);
+    printf("decode_block:         %8.1f M instructions/s (%.2fx)\n", block / 1e6, block / reference);
+    free(words);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "decoder.h"
+#include "decoder_reference.h"
+
+// Exhaustive decoder benchmark: ./bench_decode_all [threads]
+// Decodes every 32-bit word with decode_instruction on all host cores, reports the
+// decode time per word for each format, and checks that decode_instruction and
+// decode_block agree with the reference decoder on every word.
+//
+// The word space is handed out in chunks of 2^16 consecutive words. Bits 31:16 are
+// fixed within a chunk, so all its words share a format (bar the HALT word) and the
+// chunk's time is charged to that format.
+
+#define CHUNK_SHIFT 16
+#define CHUNK_WORDS (1U << CHUNK_SHIFT)
+#define CHUNK_COUNT (1U << (32 - CHUNK_SHIFT))
+
+// Rows of the report: the instruction types, plus branches of the invalid group 2.
+// decode_instruction reports each of those on stderr, so they are neither timed nor
+// passed to it; decode_block is checked on them against the quiet reference.
+#define INVALID_BRANCH (UNKNOWN + 1)
+#define FORMAT_COUNT (INVALID_BRANCH + 1)
+
+static const char* const format_names[FORMAT_COUNT] = {
+    [DP_IMM] = "DP_IMM", [DP_REG] = "DP_REG", [SDT] = "SDT", [LL] = "LL", [BRANCH] = "BRANCH",
+    [HALT] = "HALT", [UNKNOWN] = "UNKNOWN", [INVALID_BRANCH] = "BRANCH (group 2)",
+};
+
+typedef struct {
+    pthread_t thread;
+    uint64_t words[FORMAT_COUNT];
+    double seconds[FORMAT_COUNT];
+    uint64_t mismatches;
+    uint32_t first_mismatch;
+    uint32_t checksum;
+} Worker;
+
+static atomic_uint next_chunk;
+
+static double thread_seconds(void) { // CPU time of the calling thread
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static unsigned chunk_format(uint32_t first) {
+    InstructionType type = get_instruction_type(first | 1); // | 1: never the HALT word
+    return type == BRANCH && first >> 30 == 2 ? INVALID_BRANCH : type;
+}
+
+static void note_mismatch(Worker* worker, uint32_t word) {
+    if (worker->mismatches++ == 0) worker->first_mismatch = word; // Chunks are taken in order
+}
+
+static void* run_worker(void* arg) {
+    Worker* worker = arg;
+    DecodedInstruction* decoded = malloc(CHUNK_WORDS * sizeof(DecodedInstruction));
+    uint32_t* words = malloc(CHUNK_WORDS * sizeof(uint32_t));
+    if (!decoded || !words) {
+        perror("Failed to allocate chunk buffers");
+        exit(EXIT_FAILURE);
+    }
+
+    unsigned chunk;
+    while ((chunk = atomic_fetch_add(&next_chunk, 1)) < CHUNK_COUNT) {
+        uint32_t first = (uint32_t)chunk << CHUNK_SHIFT;
+        unsigned format = chunk_format(first);
+
+        if (format != INVALID_BRANCH) {
+            double start = thread_seconds();
+            for (uint32_t k = 0; k < CHUNK_WORDS; k++) {
+                DecodedInstruction instr = decode_instruction(first + k);
+                worker->checksum += instr.type + instr.dp_reg.rd + instr.dp_reg.rn;
+            }
+            worker->seconds[format] += thread_seconds() - start;
+        }
+        worker->words[format] += CHUNK_WORDS;
+
+        for (uint32_t k = 0; k < CHUNK_WORDS; k++) words[k] = first + k;
+        decode_block(words, CHUNK_WORDS, decoded);
+        if (format == INVALID_BRANCH) {
+            for (uint32_t k = 0; k < CHUNK_WORDS; k++) {
+                DecodedInstruction expected = decode_fields_reference(first + k);
+                if (memcmp(&expected, &decoded[k], sizeof(DecodedInstruction)) != 0) note_mismatch(worker, first + k);
+            }
+            continue;
+        }
+        for (uint32_t k = 0; k < CHUNK_WORDS; k++) {
+            DecodedInstruction expected = decode_instruction_reference(first + k);
+            DecodedInstruction actual = decode_instruction(first + k);
+            if (memcmp(&expected, &actual, sizeof(DecodedInstruction)) != 0 ||
+                memcmp(&expected, &decoded[k], sizeof(DecodedInstruction)) != 0) {
+                note_mismatch(worker, first + k);
+            }
+        }
+    }
+    free(decoded);
+    free(words);
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (argc > 2 || (argc == 2 && (threads = strtol(argv[1], NULL, 10)) <= 0)) {
+        fprintf(stderr, "Usage: %s [threads]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (threads < 1) threads = 1;
+
+    Worker* workers = calloc(threads, sizeof(Worker));
+    if (!workers) return EXIT_FAILURE;
+
+    printf("Decoding all 2^32 words on %ld threads...\n", threads);
+    fflush(stdout);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long t = 0; t < threads; t++) {
+        if (pthread_create(&workers[t].thread, NULL, run_worker, &workers[t]) != 0) {
+            perror("Failed to start worker thread");
+            return EXIT_FAILURE;
+        }
+    }
+    for (long t = 0; t < threads; t++) pthread_join(workers[t].thread, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    Worker total = { 0 };
+    for (long t = 0; t < threads; t++) {
+        for (unsigned f = 0; f < FORMAT_COUNT; f++) {
+            total.words[f] += workers[t].words[f];
+            total.seconds[f] += workers[t].seconds[f];
+        }
+        if (workers[t].mismatches > 0 && (total.mismatches == 0 || workers[t].first_mismatch < total.first_mismatch)) {
+            total.first_mismatch = workers[t].first_mismatch;
+        }
+        total.mismatches += workers[t].mismatches;
+        total.checksum += workers[t].checksum;
+    }
+
+    uint64_t timed_words = 0;
+    double timed_seconds = 0;
+    printf("%-18s %12s %10s\n", "format", "words", "ns/word");
+    for (unsigned f = 0; f < FORMAT_COUNT; f++) {
+        if (total.words[f] == 0) continue;
+        if (f == INVALID_BRANCH) {
+            printf("%-18s %12" PRIu64 " %10s\n", format_names[f], total.words[f], "not timed");
+            continue;
+        }
+        printf("%-18s %12" PRIu64 " %10.2f\n", format_names[f], total.words[f], total.seconds[f] * 1e9 / total.words[f]);
+        timed_words += total.words[f];
+        timed_seconds += total.seconds[f];
+    }
+    printf("%-18s %12" PRIu64 " %10.2f\n", "all timed", timed_words, timed_seconds * 1e9 / timed_words);
+    printf("Wall time %.1f s (checksum %08x)\n",
+           (double)(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9, total.checksum);
+
+    free(workers);
+    if (total.mismatches > 0) {
+        printf("FAIL: %" PRIu64 " words decode differently from the reference decoder, first 0x%08x\n",
+               total.mismatches, total.first_mismatch);
+        return EXIT_FAILURE;
+    }
+    printf("All words decode as with the reference decoder.\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "block_engine.h"
+#include "executor.h"
+#include "loop_idioms.h"
+#include "watchpoint.h"
+#ifdef JIT_ENABLED
+#include "jit.h"
+#endif
+#ifdef CACHE_SIM_ENABLED
+#include "cache_sim.h"
+#endif
+
+#ifdef THREADED_DISPATCH
+// Threaded engine: call the handler bound at decode time
+#define DISPATCH(state, entry) ((entry)->handler((state), &(entry)->instr))
+#else
+// Switch engine: dispatch on the instruction type (fused groups only have a handler)
+#define DISPATCH(state, entry) \
+    ((entry)->fused_length > 1 ? (entry)->handler((state), &(entry)->instr) \
+                               : execute_instruction((state), &(entry)->instr))
+#endif
+
+#ifdef CACHE_SIM_ENABLED
+// Feeds the fetch of count instructions from the PC to the cache model, if any
+#define SIMULATE_FETCH(state, count) \
+    do { \
+        if ((state)->cache_sim) cache_sim_fetch((state)->cache_sim, (state)->pc, (count)); \
+    } while (0)
+#define SIMULATING(state) ((state)->cache_sim != NULL)
+#else
+#define SIMULATE_FETCH(state, count) ((void)0)
+#define SIMULATING(state) false
+#endif
+
+// Loop idioms copy and fill whole arrays at once, skipping the individual loads and
+// stores that the cache model and watchpoints have to see
+#define IDIOMS_ENABLED(state) (!SIMULATING(state) && !watchpoints_active())
+
+const DecodedInstruction* execute_block(ARMState* state, DecodeCache* cache, uint64_t* last_pc) {
+    CachedInstruction* entry = decode_cache_fetch_block(cache, state, state->pc);
+    DecodedPage* page = cache->pages[state->pc >> DECODE_PAGE_SHIFT];
+    uint32_t generation = page->generation;
+    uint32_t remaining = entry->block_length;
+
+    // Delay, fill and copy loops run to completion in closed form
+    if (entry->idiom != LOOP_NONE && IDIOMS_ENABLED(state) && run_loop_idiom(state, cache, entry)) {
+        *last_pc = state->pc - 4;
+        return &entry[remaining - 1].instr;
+    }
+
+#ifdef JIT_ENABLED
+    if (entry->native == NULL && cache->jit != NULL) {
+        if (entry->heat < JIT_HOT_THRESHOLD) {
+            if (++entry->heat == JIT_HOT_THRESHOLD && !jit_request(cache->jit, page, entry, state->pc)) {
+                entry->heat--; // Compiler busy: retry on the next entry
+            }
+        } else if (entry->heat == JIT_QUEUED) {
+            jit_install_ready(cache->jit);
+        }
+    }
+    if (entry->native != NULL) {
+        uint64_t block_pc = state->pc;
+        if (entry->native(state)) {
+            *last_pc = block_pc + 4 * (remaining - 1);
+            return &entry[remaining - 1].instr;
+        }
+        // Side exit: interpret the rest of the block from the instruction that left
+        uint32_t done = (uint32_t)((state->pc - block_pc) >> 2);
+        entry += done;
+        remaining -= done;
+    }
+#endif
+
+    // Straight-line body: none of these instructions can modify the PC. Each step
+    // runs one instruction or one fused group (see fusion.h).
+    while (remaining > entry->fused_length) {
+        uint32_t count = entry->fused_length;
+        SIMULATE_FETCH(state, count);
+        DISPATCH(state, entry);
+        state->pc += 4;
+        entry += count;
+        remaining -= count;
+
+        // A store rewrote code in this page: resume from a fresh decode
+        if (page->generation != generation) {
+            *last_pc = state->pc - 4;
+            return &entry[-1].instr;
+        }
+    }
+
+    // Block terminator (or the last instruction before the page boundary), possibly
+    // at the end of a fused group
+    *last_pc = state->pc + 4 * (remaining - 1);
+    SIMULATE_FETCH(state, remaining);
+    if (!DISPATCH(state, entry)) {
+        state->pc += 4;
+    }
+    return &entry[remaining - 1].instr;
+}
+
+void run_blocks(ARMState* state, DecodeCache* cache) {
+    // Flag to control the main emulation loop
+    bool running = true;
+    
+    // Execution proceeds one basic block at a time; the per-instruction checks only
+    // apply at block boundaries, where the PC can change non-sequentially.
+    while (running && state->pc < state->memory_size) { // Continue as long as 'running' is true and PC is within memory bounds
+        // Check if the Program Counter is 4-byte aligned
+        if (state->pc % 4 != 0) { 
+             fprintf(stderr, "Error: PC (0x%016"PRIx64") is not 4-byte aligned. Terminating.\n", state->pc);
+             running = false;
+             break; // Exit loop immediately for critical error
+        }
+
+        // Run the block at the current PC; prev_pc is the address of its last instruction
+        uint64_t prev_pc;
+        const DecodedInstruction* last_instr = execute_block(state, cache, &prev_pc);
+
+        // After executing the block, check if it ended with the HALT instruction.
+        // We now set the 'running' flag to false to exit the emulation loop.
+        if (last_instr->type == HALT) {
+            running = false; 
+        } 
+
+        // Detect if the Program Counter has not advanced past the last instruction of the block.
+        // This catches infinite loops like 'b .' (branch to self) where the PC might get stuck.
+        // This check is only performed if the emulator is still considered 'running' after the block.
+        if (running && state->pc == prev_pc) { 
+            fprintf(stderr, "Warning: PC did not advance (0x%016"PRIx64"). Possible infinite loop. Terminating.\n", state->pc);
+            running = false; // Set flag to stop execution
+        }
+    }
+}
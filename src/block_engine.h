@@ -0,0 +1,19 @@
+#ifndef BLOCK_ENGINE_H
+#define BLOCK_ENGINE_H
+
+#include <stdint.h>
+#include "arm_state.h"
+#include "decode_cache.h"
+
+// Executes the basic block starting at state->pc (4-byte aligned, within memory).
+// Every instruction but the last falls through, so PC alignment, HALT and the
+// "PC did not advance" checks only need to run once per block, on the returned
+// last instruction. The block is cut short if a store invalidates its page.
+// On return, *last_pc holds the address of the last instruction executed.
+const DecodedInstruction* execute_block(ARMState* state, DecodeCache* cache, uint64_t* last_pc);
+
+// Runs blocks from state->pc until HALT, an unknown instruction, a stalled or
+// misaligned PC, or the PC leaving memory. Diagnostics go to stderr.
+void run_blocks(ARMState* state, DecodeCache* cache);
+
+#endif
@@ -0,0 +1,366 @@
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "cache_sim.h"
+
+#define REPORT_ROWS 20         // PCs and regions listed, most misses first
+#define PC_TABLE_INITIAL 1024  // Slots; a power of two
+#define MAX_WAYS 64
+
+typedef struct {
+    uint64_t* tags;   // sets * ways line numbers
+    uint64_t* stamps; // When each way was last used (0: empty)
+    uint64_t sets;
+    unsigned ways;
+    uint64_t accesses;
+    uint64_t misses;
+} CacheLevel;
+
+typedef struct {
+    uint64_t accesses;
+    uint64_t l1_misses; // Missed L1D
+    uint64_t l2_misses; // Missed L1D and L2
+} DataCounters;
+
+typedef struct {
+    uint64_t key;          // pc + 1 (0: free slot)
+    uint64_t fetch_misses; // L1I misses fetching the instruction
+    DataCounters data;     // Its loads and stores
+} PcCounters;
+
+struct CacheSim {
+    CacheConfig config;
+    CacheLevel l1i, l1d, l2;
+    unsigned line_shift;
+    unsigned region_shift;
+    uint64_t clock;           // Stamp of the latest access, shared by all levels
+    uint64_t last_fetch_line; // L1I line of the previous fetch (UINT64_MAX: none)
+
+    DataCounters* regions;
+    uint64_t region_count;
+
+    PcCounters* pcs; // Open addressing with linear probing
+    size_t pc_capacity;
+    size_t pc_count;
+};
+
+// --- Configuration ---
+
+void cache_config_default(CacheConfig* config) {
+    config->l1i = (CacheLevelConfig){ .size = 32 * 1024, .ways = 2 };
+    config->l1d = (CacheLevelConfig){ .size = 32 * 1024, .ways = 4 };
+    config->l2 = (CacheLevelConfig){ .size = 512 * 1024, .ways = 16 };
+    config->line_size = 64;
+    config->region_size = 4096;
+}
+
+static bool is_power_of_two(uint64_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+// A size such as 512, 32K or 1M; advances *text past it
+static bool parse_size(const char** text, uint64_t* size) {
+    char* end;
+    uint64_t value = strtoull(*text, &end, 10);
+    if (end == *text || **text == '-') return false;
+    if (*end == 'K' || *end == 'k') {
+        value <<= 10;
+        end++;
+    } else if (*end == 'M' || *end == 'm') {
+        value <<= 20;
+        end++;
+    }
+    *text = end;
+    *size = value;
+    return true;
+}
+
+static bool level_valid(const CacheLevelConfig* level, unsigned line_size) {
+    if (level->ways == 0 || level->ways > MAX_WAYS || level->size % ((uint64_t)line_size * level->ways) != 0) {
+        return false;
+    }
+    return is_power_of_two(level->size / ((uint64_t)line_size * level->ways));
+}
+
+bool cache_config_parse(CacheConfig* config, const char* text) {
+    cache_config_default(config);
+    while (*text != '\0') {
+        size_t item_length = strcspn(text, ",");
+        const char* value = memchr(text, '=', item_length);
+        size_t key_length = value ? (size_t)(value - text) : item_length;
+        if (!value) {
+            if (key_length != 3 || strncmp(text, "a53", 3) != 0) return false;
+            text += key_length;
+        } else {
+            value++;
+            uint64_t size;
+            if (!parse_size(&value, &size)) return false;
+            CacheLevelConfig* level = NULL;
+            if (key_length == 3 && strncmp(text, "l1i", 3) == 0) level = &config->l1i;
+            else if (key_length == 3 && strncmp(text, "l1d", 3) == 0) level = &config->l1d;
+            else if (key_length == 2 && strncmp(text, "l2", 2) == 0) level = &config->l2;
+
+            if (level) { // size[:ways]
+                level->size = size;
+                if (*value == ':') {
+                    value++;
+                    uint64_t ways;
+                    if (!parse_size(&value, &ways) || ways > MAX_WAYS) return false;
+                    level->ways = (unsigned)ways;
+                }
+            } else if (key_length == 4 && strncmp(text, "line", 4) == 0) {
+                if (size < 4 || size > 4096) return false;
+                config->line_size = (unsigned)size;
+            } else if (key_length == 6 && strncmp(text, "region", 6) == 0) {
+                config->region_size = size;
+            } else {
+                return false;
+            }
+            text = value;
+        }
+        if (*text == ',') {
+            text++;
+        } else if (*text != '\0') {
+            return false;
+        }
+    }
+    return is_power_of_two(config->line_size) && is_power_of_two(config->region_size) &&
+           config->region_size >= 4 && level_valid(&config->l1i, config->line_size) &&
+           level_valid(&config->l1d, config->line_size) && level_valid(&config->l2, config->line_size);
+}
+
+// --- Model ---
+
+static bool level_init(CacheLevel* level, const CacheLevelConfig* config, unsigned line_size) {
+    memset(level, 0, sizeof(*level));
+    level->ways = config->ways;
+    level->sets = config->size / ((uint64_t)line_size * config->ways);
+    level->tags = calloc(level->sets * level->ways, sizeof(uint64_t));
+    level->stamps = calloc(level->sets * level->ways, sizeof(uint64_t));
+    return level->tags && level->stamps;
+}
+
+static void level_free(CacheLevel* level) {
+    free(level->tags);
+    free(level->stamps);
+}
+
+CacheSim* cache_sim_create(const CacheConfig* config, uint64_t memory_size) {
+    CacheSim* sim = calloc(1, sizeof(CacheSim));
+    if (!sim) return NULL;
+    sim->config = *config;
+    sim->line_shift = (unsigned)__builtin_ctzll(config->line_size);
+    sim->region_shift = (unsigned)__builtin_ctzll(config->region_size);
+    sim->last_fetch_line = UINT64_MAX;
+    sim->region_count = (memory_size + config->region_size - 1) >> sim->region_shift;
+    sim->regions = calloc(sim->region_count, sizeof(DataCounters));
+    sim->pc_capacity = PC_TABLE_INITIAL;
+    sim->pcs = calloc(sim->pc_capacity, sizeof(PcCounters));
+
+    bool levels = level_init(&sim->l1i, &config->l1i, config->line_size) &&
+                  level_init(&sim->l1d, &config->l1d, config->line_size) &&
+                  level_init(&sim->l2, &config->l2, config->line_size);
+    if (!levels || !sim->regions || !sim->pcs) {
+        cache_sim_free(sim);
+        return NULL;
+    }
+    return sim;
+}
+
+void cache_sim_free(CacheSim* sim) {
+    if (sim == NULL) return;
+    level_free(&sim->l1i);
+    level_free(&sim->l1d);
+    level_free(&sim->l2);
+    free(sim->regions);
+    free(sim->pcs);
+    free(sim);
+}
+
+// Looks line up in level, filling it on a miss over the least recently used way
+static bool level_access(CacheLevel* level, uint64_t line, uint64_t stamp) {
+    level->accesses++;
+    uint64_t base = (line & (level->sets - 1)) * level->ways;
+    uint64_t* tags = &level->tags[base];
+    uint64_t* stamps = &level->stamps[base];
+    unsigned victim = 0;
+    for (unsigned way = 0; way < level->ways; way++) {
+        if (stamps[way] != 0 && tags[way] == line) {
+            stamps[way] = stamp;
+            return true;
+        }
+        if (stamps[way] < stamps[victim]) victim = way;
+    }
+    level->misses++;
+    tags[victim] = line;
+    stamps[victim] = stamp;
+    return false;
+}
+
+// Levels missed on the way to line through l1 and then L2 (0, 1 or 2)
+static unsigned hierarchy_access(CacheSim* sim, CacheLevel* l1, uint64_t line) {
+    uint64_t stamp = ++sim->clock;
+    if (level_access(l1, line, stamp)) return 0;
+    return level_access(&sim->l2, line, stamp) ? 1 : 2;
+}
+
+static void pc_table_grow(CacheSim* sim) {
+    size_t capacity = sim->pc_capacity * 2;
+    PcCounters* pcs = calloc(capacity, sizeof(PcCounters));
+    if (!pcs) return; // Keep probing the full table; it still has free slots
+    for (size_t i = 0; i < sim->pc_capacity; i++) {
+        if (sim->pcs[i].key == 0) continue;
+        size_t slot = (size_t)((sim->pcs[i].key >> 2) * 0x9E3779B97F4A7C15ULL) & (capacity - 1);
+        while (pcs[slot].key != 0) slot = (slot + 1) & (capacity - 1);
+        pcs[slot] = sim->pcs[i];
+    }
+    free(sim->pcs);
+    sim->pcs = pcs;
+    sim->pc_capacity = capacity;
+}
+
+// Counters of the instruction at pc, created on first use
+static PcCounters* pc_counters(CacheSim* sim, uint64_t pc) {
+    uint64_t key = pc + 1;
+    size_t mask = sim->pc_capacity - 1;
+    size_t slot = (size_t)((key >> 2) * 0x9E3779B97F4A7C15ULL) & mask;
+    while (sim->pcs[slot].key != key) {
+        if (sim->pcs[slot].key == 0) {
+            if (4 * (sim->pc_count + 1) > 3 * sim->pc_capacity) {
+                pc_table_grow(sim);
+                if (sim->pc_capacity != mask + 1) return pc_counters(sim, pc);
+                if (sim->pc_count + 1 == sim->pc_capacity) return NULL; // Full, and could not grow
+            }
+            sim->pcs[slot].key = key;
+            sim->pc_count++;
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return &sim->pcs[slot];
+}
+
+void cache_sim_fetch(CacheSim* sim, uint64_t pc, unsigned count) {
+    for (unsigned i = 0; i < count; i++, pc += 4) {
+        // Only fetches use L1I, so the line of the previous fetch is still there and
+        // still the most recently used one of its set
+        uint64_t line = pc >> sim->line_shift;
+        if (line == sim->last_fetch_line) {
+            sim->l1i.accesses++;
+            continue;
+        }
+        sim->last_fetch_line = line;
+        if (hierarchy_access(sim, &sim->l1i, line) > 0) {
+            PcCounters* counters = pc_counters(sim, pc);
+            if (counters) counters->fetch_misses++;
+        }
+    }
+}
+
+static void count_data(DataCounters* counters, unsigned missed) {
+    counters->accesses++;
+    counters->l1_misses += missed >= 1;
+    counters->l2_misses += missed == 2;
+}
+
+void cache_sim_data(CacheSim* sim, uint64_t pc, uint64_t address, unsigned width) {
+    // An unaligned access may span two lines; it missed as deep as its worst line
+    unsigned missed = 0;
+    for (uint64_t line = address >> sim->line_shift; line <= (address + width - 1) >> sim->line_shift; line++) {
+        unsigned line_missed = hierarchy_access(sim, &sim->l1d, line);
+        if (line_missed > missed) missed = line_missed;
+    }
+    PcCounters* counters = pc_counters(sim, pc);
+    if (counters) count_data(&counters->data, missed);
+    count_data(&sim->regions[address >> sim->region_shift], missed);
+}
+
+// --- Report ---
+
+static double percent(uint64_t part, uint64_t whole) {
+    return whole == 0 ? 0.0 : 100.0 * (double)part / (double)whole;
+}
+
+static void format_size(char* text, size_t length, uint64_t size) {
+    if (size >= (1 << 20) && size % (1 << 20) == 0) {
+        snprintf(text, length, "%" PRIu64 "MB", size >> 20);
+    } else if (size >= 1024 && size % 1024 == 0) {
+        snprintf(text, length, "%" PRIu64 "KB", size >> 10);
+    } else {
+        snprintf(text, length, "%" PRIu64 "B", size);
+    }
+}
+
+static void report_level(FILE* out, const char* name, const CacheLevel* level) {
+    fprintf(out, "  %-4s %12" PRIu64 " accesses %12" PRIu64 " misses  %6.2f%% hit rate\n", name, level->accesses,
+            level->misses, 100.0 - percent(level->misses, level->accesses));
+}
+
+static int compare_pcs(const void* a, const void* b) {
+    const PcCounters* x = *(const PcCounters* const*)a;
+    const PcCounters* y = *(const PcCounters* const*)b;
+    uint64_t misses_x = x->fetch_misses + x->data.l1_misses, misses_y = y->fetch_misses + y->data.l1_misses;
+    if (misses_x != misses_y) return misses_x > misses_y ? -1 : 1;
+    return x->key < y->key ? -1 : x->key > y->key;
+}
+
+static const DataCounters* region_base; // qsort has no context argument
+
+static int compare_regions(const void* a, const void* b) {
+    const DataCounters* x = &region_base[*(const uint64_t*)a];
+    const DataCounters* y = &region_base[*(const uint64_t*)b];
+    if (x->l1_misses != y->l1_misses) return x->l1_misses > y->l1_misses ? -1 : 1;
+    if (x->accesses != y->accesses) return x->accesses > y->accesses ? -1 : 1;
+    return *(const uint64_t*)a < *(const uint64_t*)b ? -1 : 1;
+}
+
+void cache_sim_report(const CacheSim* sim, FILE* out) {
+    char l1i[16], l1d[16], l2[16], region[16];
+    format_size(l1i, sizeof(l1i), sim->config.l1i.size);
+    format_size(l1d, sizeof(l1d), sim->config.l1d.size);
+    format_size(l2, sizeof(l2), sim->config.l2.size);
+    format_size(region, sizeof(region), sim->config.region_size);
+    fprintf(out, "Cache simulation: L1I %s %u-way, L1D %s %u-way, L2 %s %u-way, %u-byte lines\n", l1i,
+            sim->config.l1i.ways, l1d, sim->config.l1d.ways, l2, sim->config.l2.ways, sim->config.line_size);
+    report_level(out, "L1I", &sim->l1i);
+    report_level(out, "L1D", &sim->l1d);
+    report_level(out, "L2", &sim->l2);
+
+    const PcCounters** pcs = malloc((sim->pc_count + 1) * sizeof(PcCounters*));
+    uint64_t* regions = malloc((sim->region_count + 1) * sizeof(uint64_t));
+    if (!pcs || !regions) {
+        free(pcs);
+        free(regions);
+        return;
+    }
+
+    size_t pc_rows = 0;
+    for (size_t i = 0; i < sim->pc_capacity; i++) {
+        if (sim->pcs[i].key != 0) pcs[pc_rows++] = &sim->pcs[i];
+    }
+    qsort(pcs, pc_rows, sizeof(PcCounters*), compare_pcs);
+    fprintf(out, "PCs with the most misses (L1I misses fetching them; L1D and L2 miss rates of their loads and stores):\n");
+    for (size_t i = 0; i < pc_rows && i < REPORT_ROWS; i++) {
+        const PcCounters* pc = pcs[i];
+        fprintf(out, "  0x%08" PRIx64 ": %8" PRIu64 " fetch misses %12" PRIu64 " data accesses  L1D %6.2f%%  L2 %6.2f%%\n",
+                pc->key - 1, pc->fetch_misses, pc->data.accesses, percent(pc->data.l1_misses, pc->data.accesses),
+                percent(pc->data.l2_misses, pc->data.accesses));
+    }
+
+    size_t region_rows = 0;
+    for (uint64_t i = 0; i < sim->region_count; i++) {
+        if (sim->regions[i].accesses != 0) regions[region_rows++] = i;
+    }
+    region_base = sim->regions;
+    qsort(regions, region_rows, sizeof(uint64_t), compare_regions);
+    fprintf(out, "Data regions (%s) with the most L1D misses (L1D and L2 miss rates):\n", region);
+    for (size_t i = 0; i < region_rows && i < REPORT_ROWS; i++) {
+        const DataCounters* counters = &sim->regions[regions[i]];
+        uint64_t start = regions[i] << sim->region_shift;
+        fprintf(out, "  0x%08" PRIx64 "-0x%08" PRIx64 ": %12" PRIu64 " accesses  L1D %6.2f%%  L2 %6.2f%%\n", start,
+                start + sim->config.region_size - 1, counters->accesses, percent(counters->l1_misses, counters->accesses),
+                percent(counters->l2_misses, counters->accesses));
+    }
+    free(pcs);
+    free(regions);
+}
@@ -0,0 +1,52 @@
+#ifndef CACHE_SIM_H
+#define CACHE_SIM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Guest cache hierarchy model (`emulate -C <config>`), for tuning data layouts
+// without the hardware. Instruction fetches go through L1I, loads and stores through
+// L1D, and misses in either through a shared L2. Every level is set-associative with
+// LRU replacement, write-allocate, and shares one line size. At exit the model
+// reports each level's hit rate, then the PCs and data regions with the most misses.
+//
+// Only built with `make CACHE_SIM=1` (CACHE_SIM_ENABLED): in other builds neither
+// the hooks nor the model exist, so they cost nothing.
+
+typedef struct {
+    uint64_t size; // Bytes
+    unsigned ways;
+} CacheLevelConfig;
+
+typedef struct {
+    CacheLevelConfig l1i, l1d, l2;
+    unsigned line_size; // Bytes per line, at every level
+    uint64_t region_size; // Granularity of the per-region data report
+} CacheConfig;
+
+// The Cortex-A53 of the Raspberry Pi 3: 32KB 2-way L1I, 32KB 4-way L1D, 512KB
+// 16-way L2, 64-byte lines; data is reported per 4KB page
+void cache_config_default(CacheConfig* config);
+
+// Parses "a53" (the defaults), or comma-separated overrides of them such as
+// "l1d=16K:2,l2=1M:16,line=32,region=64K" (sizes take K and M suffixes).
+// Returns false if text is malformed or a level would not have a power-of-two
+// number of sets.
+bool cache_config_parse(CacheConfig* config, const char* text);
+
+typedef struct CacheSim CacheSim;
+
+// A cold hierarchy for a guest with memory_size bytes of memory; NULL if out of memory
+CacheSim* cache_sim_create(const CacheConfig* config, uint64_t memory_size);
+void cache_sim_free(CacheSim* sim);
+
+// count consecutive instructions fetched from pc on
+void cache_sim_fetch(CacheSim* sim, uint64_t pc, unsigned count);
+
+// A load or store of width bytes at address (in guest memory) by the instruction at pc
+void cache_sim_data(CacheSim* sim, uint64_t pc, uint64_t address, unsigned width);
+
+void cache_sim_report(const CacheSim* sim, FILE* out);
+
+#endif
@@ -1,7 +1,10 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
-#define MEMORY_SIZE (2 * 1024 * 1024) // 2MB
+#define MEMORY_SIZE (2 * 1024 * 1024) // 2MB, the default guest memory size
+#define MAX_MEMORY_SIZE (1024 * 1024 * 1024) // 1GB, all of a Pi 3's RAM
+#define MEMORY_PAGE_SIZE 4096 // Guest memory sizes are a whole number of pages
+#define MEMORY_PAGE_SHIFT 12 // log2(MEMORY_PAGE_SIZE)
 #define HALT_INSTRUCTION 0x8a000000
 #define ADDRESS_REGISTER_XZR 0x1F
 // Define MASK_32BIT as a 64-bit value with lower 32 bits set, for masking 64-bit variables to 32-bit effective width
@@ -0,0 +1,23 @@
+#include "content_hash.h"
+
+#define HASH_SEED  0xcbf29ce484222325ULL // FNV-1a offset basis
+#define HASH_PRIME 0x100000001b3ULL      // FNV-1a prime
+
+// FNV-1a over 64-bit little-endian lanes, with an extra shift-xor per lane so
+// high input bits reach the low output bits
+uint64_t content_hash(const uint8_t* bytes, size_t size) {
+    uint64_t hash = HASH_SEED ^ size;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t lane = 0;
+        for (int b = 0; b < 8; b++) lane |= (uint64_t)bytes[i + b] << (8 * b);
+        hash = (hash ^ lane) * HASH_PRIME;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ bytes[i]) * HASH_PRIME;
+    }
+    hash ^= hash >> 32;
+    return hash;
+}
@@ -0,0 +1,11 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 64-bit hash of a byte string, used to key files derived from a guest image.
+// Not cryptographic; it only has to tell different images apart.
+uint64_t content_hash(const uint8_t* bytes, size_t size);
+
+#endif
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decode_cache.h"
+#include "decoder.h"
+#include "loop_idioms.h"
+#include "fusion.h"
+#ifdef JIT_ENABLED
+#include "jit.h"
+#endif
+
+DecodeCache* decode_cache_create(uint64_t memory_size) {
+    DecodeCache* cache = calloc(1, sizeof(DecodeCache));
+    if (cache == NULL) {
+        perror("Failed to allocate decode cache");
+        return NULL;
+    }
+    cache->page_count = (memory_size + DECODE_PAGE_SIZE - 1) >> DECODE_PAGE_SHIFT;
+    cache->pages = calloc(cache->page_count, sizeof(DecodedPage*));
+    if (cache->pages == NULL) {
+        perror("Failed to allocate decode cache");
+        free(cache);
+        return NULL;
+    }
+#ifdef JIT_ENABLED
+    cache->jit = jit_create(cache);
+#endif
+    return cache;
+}
+
+void decode_cache_free(DecodeCache* cache) {
+    if (cache == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < cache->page_count; i++) {
+        free(cache->pages[i]);
+    }
+    free(cache->pages);
+#ifdef JIT_ENABLED
+    jit_free(cache->jit);
+#endif
+    free(cache);
+}
+
+// Returns the page holding pc, allocating it on first use
+static DecodedPage* get_page(DecodeCache* cache, uint64_t pc) {
+    DecodedPage** page_ref = &cache->pages[pc >> DECODE_PAGE_SHIFT];
+
+    if (*page_ref == NULL) {
+        // Tags are zeroed by calloc, so every slot starts out stale
+        *page_ref = calloc(1, sizeof(DecodedPage));
+        if (*page_ref == NULL) {
+            perror("Failed to allocate decode cache page");
+            exit(EXIT_FAILURE);
+        }
+        (*page_ref)->generation = 1;
+    }
+    return *page_ref;
+}
+
+CachedInstruction* decode_cache_install(DecodeCache* cache, uint64_t pc, DecodedInstruction instr, uint32_t block_length) {
+    DecodedPage* page = get_page(cache, pc);
+    uint32_t slot = (uint32_t)(pc & (DECODE_PAGE_SIZE - 1)) >> 2;
+
+    CachedInstruction* entry = &page->entries[slot];
+    entry->instr = instr;
+    entry->handler = resolve_handler(&entry->instr);
+    entry->block_length = block_length;
+    entry->idiom = LOOP_NONE; // Classified and fused with the whole block in place
+    entry->fused_length = 1;
+#ifdef JIT_ENABLED
+    // A reinstalled slot drops its translation; the old code is simply never entered again
+    entry->heat = 0;
+    entry->native = NULL;
+#endif
+    page->tags[slot] = page->generation;
+    return entry;
+}
+
+// Decodes the whole page at base in bulk and installs every word of it
+static void predecode_page(DecodeCache* cache, ARMState* state, uint64_t base) {
+    uint32_t words[DECODE_PAGE_WORDS];
+    DecodedInstruction decoded[DECODE_PAGE_WORDS];
+
+    size_t count = (state->memory_size - base) / 4;
+    if (count > DECODE_PAGE_WORDS) count = DECODE_PAGE_WORDS;
+    for (size_t k = 0; k < count; k++) {
+        words[k] = read_word_from_memory(state, (uint32_t)(base + 4 * k));
+    }
+    decode_block(words, count, decoded);
+
+    for (size_t k = 0; k < count; k++) {
+        // Left for decode_cache_fill, so that fetching one reports it as before
+        if (decoded[k].type == BRANCH && decoded[k].branch.group == 2) continue;
+        decode_cache_install(cache, base + 4 * k, decoded[k], 0);
+        cache->decodes++;
+    }
+}
+
+CachedInstruction* decode_cache_fill(DecodeCache* cache, ARMState* state, uint64_t pc) {
+    // The first fetch from a page decodes all of it, so the cost of decoding follows
+    // the code that runs rather than the size of the image
+    if (cache->pages[pc >> DECODE_PAGE_SHIFT] == NULL) {
+        predecode_page(cache, state, pc & ~(uint64_t)(DECODE_PAGE_SIZE - 1));
+        DecodedPage* page = cache->pages[pc >> DECODE_PAGE_SHIFT];
+        uint32_t slot = (uint32_t)(pc & (DECODE_PAGE_SIZE - 1)) >> 2;
+        if (page->tags[slot] == page->generation) return &page->entries[slot];
+    }
+    cache->decodes++;
+    return decode_cache_install(cache, pc, decode_instruction(read_word_from_memory(state, (uint32_t)pc)), 0);
+}
+
+// Instructions that may redirect or stop execution terminate a block. That includes
+// loads into register 31 and base writeback to it: registers[31] is where the PC
+// lives, so they jump like a branch does.
+static bool ends_block(const DecodedInstruction* instr) {
+    switch (instr->type) {
+        case SDT:
+            return (instr->sdt.L && instr->sdt.rt == 31) ||
+                   (instr->sdt.xn == 31 && (instr->sdt.mode == PRE_INDEXED || instr->sdt.mode == POST_INDEXED));
+        case LL:
+            return instr->ll.rt == 31;
+        case DP_IMM:
+        case DP_REG:
+            return false;
+        default:
+            return true; // BRANCH, HALT, UNKNOWN
+    }
+}
+
+void decode_cache_build_block(DecodeCache* cache, ARMState* state, uint64_t pc, CachedInstruction* entry) {
+    uint32_t length = 0;
+    uint64_t page_end = (pc | (DECODE_PAGE_SIZE - 1)) + 1;
+
+    // Decode ahead until the block terminator or the end of the page
+    for (uint64_t next = pc; next < page_end; next += 4) {
+        length++;
+        if (ends_block(&decode_cache_fetch(cache, state, next)->instr)) break;
+    }
+    entry->block_length = length;
+    decode_cache_analyze_block(entry, length, pc);
+}
+
+void decode_cache_analyze_block(CachedInstruction* entry, uint32_t length, uint64_t pc) {
+    entry->idiom = recognize_loop_idiom(entry, length, pc);
+    fuse_block(entry, length);
+}
+
+void decode_cache_invalidate(DecodeCache* cache, uint64_t address, size_t length) {
+    uint64_t first = address >> DECODE_PAGE_SHIFT;
+    uint64_t last = (address + length - 1) >> DECODE_PAGE_SHIFT;
+
+    for (uint64_t p = first; p <= last && p < cache->page_count; p++) {
+        DecodedPage* page = cache->pages[p];
+        if (page == NULL) continue;
+
+        // Bumping the generation makes every tag in the page stale at once.
+        // Entries stay allocated, so a pointer to the instruction currently being
+        // executed remains readable until it returns.
+        page->generation++;
+        if (page->generation == 0) {
+            // Wrapped around: reset the tags so stale slots cannot match again
+            memset(page->tags, 0, sizeof(page->tags));
+            page->generation = 1;
+        }
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef DECODE_CACHE_H
+#define DECODE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "arm_state.h"
+#include "instruction_types.h"
+#include "dispatch.h"
+
+// Predecoded instruction cache, indexed by PC.
+// Guest memory is split into 4KB pages; a page's decoded array is only allocated
+// once an instruction is fetched from it. Each page carries a generation counter
+// and every slot is tagged with the generation it was decoded in, so a store into
+// a cached page invalidates the whole page in O(1) by bumping the counter.
+#define DECODE_PAGE_SHIFT 12
+#define DECODE_PAGE_SIZE  (1U << DECODE_PAGE_SHIFT) // 4KB
+#define DECODE_PAGE_WORDS (DECODE_PAGE_SIZE / 4)
+
+// Host code for a translated block (see jit.h). Returns true if the whole block
+// ran, false on a side exit, with state->pc at the instruction to resume from.
+typedef bool (*NativeBlock)(ARMState* state);
+
+// A decoded instruction bound to its threaded-dispatch handler
+typedef struct {
+    InstructionHandler handler;
+    DecodedInstruction instr;
+    uint32_t block_length; // Instructions in the block starting here (0: not discovered yet)
+    uint8_t idiom;         // LoopIdiom of that block (see loop_idioms.h)
+    uint8_t fused_length;  // Instructions handler runs as one macro-op (1: not fused, see fusion.h)
+#ifdef JIT_ENABLED
+    uint32_t heat;         // Times the block starting here was entered
+    NativeBlock native;    // Its translation (NULL: interpreted)
+#endif
+} CachedInstruction;
+
+typedef struct {
+    uint32_t generation;                       // Current generation (starts at 1)
+    uint32_t tags[DECODE_PAGE_WORDS];          // Generation each slot was decoded in (0: never)
+    CachedInstruction entries[DECODE_PAGE_WORDS];
+} DecodedPage;
+
+typedef struct JitCompiler JitCompiler;
+
+struct DecodeCache {
+    DecodedPage** pages;                   // One per page of memory, NULL until code is fetched from it
+    uint64_t page_count;
+    JitCompiler* jit;                      // Translator for hot blocks (NULL: interpret only)
+    uint64_t decodes;                      // Instructions decoded so far (cache misses)
+};
+
+// Creates an empty cache for memory_size bytes of guest memory
+DecodeCache* decode_cache_create(uint64_t memory_size);
+void decode_cache_free(DecodeCache* cache);
+
+// Slow path of decode_cache_fetch: fetches and decodes the word at pc into its slot.
+// The first fetch from a page decodes and installs the whole page in bulk.
+CachedInstruction* decode_cache_fill(DecodeCache* cache, ARMState* state, uint64_t pc);
+
+// Stores an already decoded instruction (and the length of the block it starts,
+// 0 if unknown) as the current entry for pc
+CachedInstruction* decode_cache_install(DecodeCache* cache, uint64_t pc, DecodedInstruction instr, uint32_t block_length);
+
+// Slow path of decode_cache_fetch_block: decodes the straight-line run starting at
+// entry (the slot for pc) and records its length
+void decode_cache_build_block(DecodeCache* cache, ARMState* state, uint64_t pc, CachedInstruction* entry);
+
+// Classifies the block of length instructions at entry (address pc) and fuses the
+// instruction sequences in it; every slot of the block must be installed
+void decode_cache_analyze_block(CachedInstruction* entry, uint32_t length, uint64_t pc);
+
+// Drops every cached page overlapping [address, address + length)
+void decode_cache_invalidate(DecodeCache* cache, uint64_t address, size_t length);
+
+// Returns the decoded instruction at pc (pc must be 4-byte aligned and within memory)
+static inline CachedInstruction* decode_cache_fetch(DecodeCache* cache, ARMState* state, uint64_t pc) {
+    DecodedPage* page = cache->pages[pc >> DECODE_PAGE_SHIFT];
+    uint32_t slot = (uint32_t)(pc & (DECODE_PAGE_SIZE - 1)) >> 2;
+
+    if (page != NULL && page->tags[slot] == page->generation) {
+        return &page->entries[slot];
+    }
+    return decode_cache_fill(cache, state, pc);
+}
+
+// Returns the first instruction of the basic block starting at pc. A block is a
+// straight-line run that ends at a BRANCH, HALT or UNKNOWN instruction, a load or
+// writeback that targets register 31 (the PC), or the end of the page, so its
+// entries are contiguous in the page's array.
+static inline CachedInstruction* decode_cache_fetch_block(DecodeCache* cache, ARMState* state, uint64_t pc) {
+    CachedInstruction* entry = decode_cache_fetch(cache, state, pc);
+    if (entry->block_length == 0) {
+        decode_cache_build_block(cache, state, pc, entry);
+    }
+    return entry;
+}
+
+// Called on every guest store; cheap when the written page holds no cached code
+static inline void decode_cache_note_store(DecodeCache* cache, uint64_t address, size_t length) {
+    if (cache == NULL) return;
+    uint64_t first = address >> DECODE_PAGE_SHIFT;
+    uint64_t last = (address + length - 1) >> DECODE_PAGE_SHIFT;
+    if ((first < cache->page_count && cache->pages[first] != NULL) ||
+        (last < cache->page_count && cache->pages[last] != NULL)) {
+        decode_cache_invalidate(cache, address, length);
+    }
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "decode_cache_file.h"
+
+// Bump the version whenever the decoder's output changes meaning
+#define DECODE_CACHE_FILE_MAGIC "ARMDCv1"
+
+typedef struct {
+    char magic[8];
+    uint32_t record_size;  // sizeof(DecodeCacheRecord), so other layouts are rejected
+    uint32_t record_count;
+    uint64_t image_hash;
+} DecodeCacheFileHeader;
+
+typedef struct {
+    uint32_t pc;
+    uint32_t word;          // Instruction word the entry was decoded from
+    uint32_t block_length;
+    DecodedInstruction instr;
+} DecodeCacheRecord;
+
+size_t decode_cache_load_file(DecodeCache* cache, ARMState* state, const char* path, uint64_t image_hash,
+                              bool* stale) {
+    *stale = false;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0; // First run: nothing cached yet
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(DecodeCacheFileHeader)) {
+        close(fd);
+        *stale = true;
+        return 0;
+    }
+    size_t size = (size_t)info.st_size;
+    const uint8_t* file = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED) {
+        return 0;
+    }
+
+    const DecodeCacheFileHeader* header = (const DecodeCacheFileHeader*)file;
+    if (memcmp(header->magic, DECODE_CACHE_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->record_size != sizeof(DecodeCacheRecord) || header->image_hash != image_hash ||
+        size != sizeof(DecodeCacheFileHeader) + (size_t)header->record_count * sizeof(DecodeCacheRecord)) {
+        munmap((void*)file, size);
+        *stale = true;
+        return 0;
+    }
+
+    const DecodeCacheRecord* records = (const DecodeCacheRecord*)(file + sizeof(DecodeCacheFileHeader));
+    size_t installed = 0;
+    for (uint32_t i = 0; i < header->record_count; i++) {
+        const DecodeCacheRecord* record = &records[i];
+        if (record->pc % 4 != 0 || record->pc > state->memory_size - 4 ||
+            read_word_from_memory(state, record->pc) != record->word) {
+            continue;
+        }
+        decode_cache_install(cache, record->pc, record->instr, record->block_length);
+        installed++;
+    }
+
+    // A block is only reused if every instruction in it was installed too (code the
+    // last run wrote at runtime is not in memory yet); otherwise it is rediscovered
+    for (uint32_t i = 0; i < header->record_count; i++) {
+        const DecodeCacheRecord* record = &records[i];
+        if (record->pc % 4 != 0 || record->pc > state->memory_size - 4) continue;
+        DecodedPage* page = cache->pages[record->pc >> DECODE_PAGE_SHIFT];
+        uint32_t slot = (record->pc & (DECODE_PAGE_SIZE - 1)) >> 2;
+        if (page == NULL || page->tags[slot] != page->generation) continue;
+
+        CachedInstruction* entry = &page->entries[slot];
+        if (entry->block_length > DECODE_PAGE_WORDS - slot) {
+            entry->block_length = 0;
+            continue;
+        }
+        for (uint32_t k = 1; k < entry->block_length; k++) {
+            if (page->tags[slot + k] != page->generation) {
+                entry->block_length = 0;
+                break;
+            }
+        }
+        if (entry->block_length != 0) {
+            decode_cache_analyze_block(entry, entry->block_length, record->pc);
+        }
+    }
+    munmap((void*)file, size);
+    return installed;
+}
+
+bool decode_cache_save_file(DecodeCache* cache, ARMState* state, const char* path, uint64_t image_hash) {
+    // Write next to the target and rename, so a concurrent run never maps a half-written file
+    size_t temp_length = strlen(path) + sizeof(".tmp");
+    char* temp_path = malloc(temp_length);
+    if (temp_path == NULL) {
+        perror("Failed to allocate decode cache file name");
+        return false;
+    }
+    snprintf(temp_path, temp_length, "%s.tmp", path);
+
+    FILE* file = fopen(temp_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: Could not write decode cache file '%s'\n", temp_path);
+        free(temp_path);
+        return false;
+    }
+
+    DecodeCacheFileHeader header = {0};
+    memcpy(header.magic, DECODE_CACHE_FILE_MAGIC, sizeof(header.magic));
+    header.record_size = sizeof(DecodeCacheRecord);
+    header.image_hash = image_hash;
+    fwrite(&header, sizeof(header), 1, file); // Rewritten with the count below
+
+    for (size_t p = 0; p < cache->page_count; p++) {
+        const DecodedPage* page = cache->pages[p];
+        if (page == NULL) continue;
+        for (uint32_t slot = 0; slot < DECODE_PAGE_WORDS; slot++) {
+            if (page->tags[slot] != page->generation) continue;
+
+            DecodeCacheRecord record;
+            memset(&record, 0, sizeof(record));
+            record.pc = (uint32_t)((p << DECODE_PAGE_SHIFT) + slot * 4);
+            // No store hit the page since the slot was decoded, so memory still holds its word
+            record.word = read_word_from_memory(state, record.pc);
+            record.block_length = page->entries[slot].block_length;
+            record.instr = page->entries[slot].instr;
+            fwrite(&record, sizeof(record), 1, file);
+            header.record_count++;
+        }
+    }
+
+    rewind(file);
+    fwrite(&header, sizeof(header), 1, file);
+    bool ok = !ferror(file);
+    ok = (fclose(file) == 0) && ok;
+    if (ok && rename(temp_path, path) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Could not write decode cache file '%s'\n", path);
+        remove(temp_path);
+    }
+    free(temp_path);
+    return ok;
+}
@@ -0,0 +1,28 @@
+#ifndef DECODE_CACHE_FILE_H
+#define DECODE_CACHE_FILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "arm_state.h"
+#include "decode_cache.h"
+
+// Persistent decode cache (`emulate -c <cache_file>`).
+// The decoded instructions and block lengths of a run are saved to a file keyed by
+// the content hash of the loaded image, so the next run on the same image starts
+// with a warm cache. A file written for another image, or by a build with another
+// record layout, is rejected as a whole. Each record also keeps the word it was
+// decoded from and is only installed if memory holds that word, so runtime-written
+// code can never be served stale. Translated host code (JIT=1) is not persisted:
+// it embeds host addresses that change from run to run.
+
+// Maps path and installs its records into cache. Returns the number installed;
+// 0 if there is no usable file, with *stale set if one exists for another image.
+size_t decode_cache_load_file(DecodeCache* cache, ARMState* state, const char* path, uint64_t image_hash,
+                              bool* stale);
+
+// Writes every valid cache entry to path, replacing it atomically. Returns false
+// (after reporting why) if the file could not be written.
+bool decode_cache_save_file(DecodeCache* cache, ARMState* state, const char* path, uint64_t image_hash);
+
+#endif
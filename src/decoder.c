@@ -1,162 +1,247 @@
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 #include "decoder.h"
 
-uint32_t get_bits(uint32_t value, uint8_t start, uint8_t end);
-InstructionType get_instruction_type(uint32_t instruction_word);
-int64_t sign_extend(uint32_t value, uint8_t bits);
-
-DecodedInstruction decode_instruction(uint32_t instruction_word) {
-    DecodedInstruction i;
-
-    memset(&i, 0, sizeof(DecodedInstruction));  // Initialize all fields to zero
-    i.raw_instruction = instruction_word;
-    i.type = get_instruction_type(instruction_word);
-
-    // Populate the appropriate fields based on the instruction type
-    switch (i.type) {
-        case DP_IMM: {
-            i.sf = get_bits(instruction_word, 31, 31);
-            i.dp_opc = get_bits(instruction_word, 29, 30);
-            i.dp_imm_opi = get_bits(instruction_word, 23, 25);
-            i.dp_rd = get_bits(instruction_word, 0, 4);
-
-            if (i.dp_imm_opi == 0x2) {  // Arithmetic operation
-                i.dp_imm_sh = get_bits(instruction_word, 22, 22);
-                i.dp_imm_imm12 = get_bits(instruction_word, 10, 21);
-                i.dp_rn = get_bits(instruction_word, 5, 9);
-            } else if (i.dp_imm_opi == 0x5) {  // Wide move
-                i.dp_imm_hw = get_bits(instruction_word, 21, 22);
-                i.dp_imm_imm16 = get_bits(instruction_word, 5, 20);
-            }
-
-            break;
-        }
-        case DP_REG: {
-            i.sf = get_bits(instruction_word, 31, 31);
-            i.dp_opc = get_bits(instruction_word, 29, 30);
-            i.dp_reg_M = get_bits(instruction_word, 28, 28);
-            i.dp_reg_opr = get_bits(instruction_word, 21, 24);
-            i.dp_reg_rm = get_bits(instruction_word, 16, 20);
-            i.dp_reg_shift_amount = get_bits(instruction_word, 10, 15);
-            i.dp_rn = get_bits(instruction_word, 5, 9);
-            i.dp_rd = get_bits(instruction_word, 0, 4);
-
-            if (i.dp_reg_M) {  // Multiply operation
-                i.dp_reg_x = get_bits(instruction_word, 15, 15);
-                i.dp_reg_ra = get_bits(instruction_word, 10, 14);
-            } else {  // Arithmetic or Logical operation
-                i.dp_reg_shift_type = get_bits(instruction_word, 22, 23);
-                i.dp_reg_N = get_bits(instruction_word, 21, 21);
-            }
-
-            break;
-        }
-        case SDT: {
-            i.sf = get_bits(instruction_word, 30, 30);
-            i.sdt_U = get_bits(instruction_word, 24, 24);
-            i.sdt_L = get_bits(instruction_word, 22, 22);
-            i.sdt_xn = get_bits(instruction_word, 5, 9);
-            i.sdt_ll_rt = get_bits(instruction_word, 0, 4);
-
-            // Determine the type of offset based on the instruction format
-            // U == 1: Unsigned offset
-            // U == 0 and bit 21 is 1: Register offset
-            // U == 0 and bit 21 is 0: Pre/Post-indexing
-            if (i.sdt_U) {  // Unsigned offset
-                i.sdt_imm12 = get_bits(instruction_word, 10, 21);
-            } else if (get_bits(instruction_word, 21, 21)) {  // Register offset
-                i.sdt_xm = get_bits(instruction_word, 16, 20);
-            } else {  // Pre/Post-indexing
-                i.sdt_simm9 = sign_extend(get_bits(instruction_word, 12, 20), 9);
-                i.sdt_I = get_bits(instruction_word, 11, 11);
-            }
-
-            break;
-        }
-        case LL: {
-            i.sf = get_bits(instruction_word, 30, 30);
-            // Sign-extend to 64 bits
-            i.ll_simm19 = sign_extend(get_bits(instruction_word, 5, 23), 19);
-            i.sdt_ll_rt = get_bits(instruction_word, 0, 4);
-            break;
-        }
-        case BRANCH: {
-            // Compare the two most significant bits to determine the branch type
-            switch (get_bits(instruction_word, 30, 31)) {
-                case 0: {  // Unconditional branch (00)
-                    i.b_simm26 = sign_extend(get_bits(instruction_word, 0, 25), 26);
-                    i.b_xn = get_bits(instruction_word, 5, 9);
-                    break;
-                }
-                case 3: {  // Register branch (11)
-                    i.b_xn = get_bits(instruction_word, 5, 9);
-                    break;
-                }
-                case 1: {  // Conditional branch (01)
-                    i.b_cond = get_bits(instruction_word, 0, 3);
-                    i.b_simm19 = sign_extend(get_bits(instruction_word, 5, 23), 19);
-                    break;
-                }
-                default: {
-                    fprintf(stderr, "Error: Invalid branch instruction format\n");
-                    break;
-                }
-            }
-            break;
-        }
-        case HALT:
-        case UNKNOWN: {
-            // No additional fields to decode for HALT or UNKNOWN
-            break;
-        }
-        default: {
-            fprintf(stderr, "Error: Unknown instruction type %d\n", i.type);
-            break;
-        }
+// Every field is read by an extractor generated from the layout lists below, so its
+// bounds are compile-time constants and each read is a shift and a mask. Entries
+// are X(name, hi, lo) for the field at bits [hi:lo].
+#define COMMON_FIELDS(X) \
+    X(sf, 31, 31) X(opc, 30, 29) X(rn, 9, 5) X(rd, 4, 0)
+#define DP_IMM_FIELDS(X) \
+    X(opi, 25, 23) X(sh, 22, 22) X(imm12, 21, 10) X(hw, 22, 21) X(imm16, 20, 5)
+#define DP_REG_FIELDS(X) \
+    X(M, 28, 28) X(opr, 24, 21) X(shift, 23, 22) X(N, 21, 21) X(rm, 20, 16) X(imm6, 15, 10) \
+    X(x, 15, 15) X(ra, 14, 10)
+#define SDT_FIELDS(X) \
+    X(size, 30, 30) X(U, 24, 24) X(L, 22, 22) X(offset_register, 21, 21) X(simm9, 20, 12) \
+    X(xm, 20, 16) X(I, 11, 11)
+#define LL_FIELDS(X) \
+    X(simm19, 23, 5)
+#define BRANCH_FIELDS(X) \
+    X(group, 31, 30) X(simm26, 25, 0) X(cond, 3, 0)
+
+#define DEFINE_EXTRACTOR(name, hi, lo) \
+    static inline uint32_t field_##name(uint32_t word) { \
+        return (word >> (lo)) & (uint32_t)((1ULL << ((hi) - (lo) + 1)) - 1); \
     }
-    return i;
+COMMON_FIELDS(DEFINE_EXTRACTOR)
+DP_IMM_FIELDS(DEFINE_EXTRACTOR)
+DP_REG_FIELDS(DEFINE_EXTRACTOR)
+SDT_FIELDS(DEFINE_EXTRACTOR)
+LL_FIELDS(DEFINE_EXTRACTOR)
+BRANCH_FIELDS(DEFINE_EXTRACTOR)
+
+// Sign-extends the low bits of value
+static inline int32_t sign_extend(uint32_t value, unsigned bits) {
+    return (int32_t)(value << (32 - bits)) >> (32 - bits);
 }
 
-uint32_t get_bits(uint32_t value, uint8_t start, uint8_t end) {
-    // Extract bits from start index to end index (inclusive)
-    return (value >> start) & ((1U << (end - start + 1)) - 1);
-}
+// Instruction group by op0 (bits 28:25), four bits per entry so the whole table
+// lives in one register:
+//   100x  Data Processing (Immediate)
+//   x101  Data Processing (Register)
+//   x1x0  Loads and Stores (SDT here; bit 31 clear makes it LL)
+//   101x  Branches
+#define OP0_GROUP(op0, type) ((uint64_t)(type) << (4 * (op0)))
+static const uint64_t op0_groups =
+    OP0_GROUP(0x0, UNKNOWN) | OP0_GROUP(0x1, UNKNOWN) | OP0_GROUP(0x2, UNKNOWN) | OP0_GROUP(0x3, UNKNOWN) |
+    OP0_GROUP(0x4, SDT)     | OP0_GROUP(0x5, DP_REG)  | OP0_GROUP(0x6, SDT)     | OP0_GROUP(0x7, UNKNOWN) |
+    OP0_GROUP(0x8, DP_IMM)  | OP0_GROUP(0x9, DP_IMM)  | OP0_GROUP(0xA, BRANCH)  | OP0_GROUP(0xB, BRANCH)  |
+    OP0_GROUP(0xC, SDT)     | OP0_GROUP(0xD, DP_REG)  | OP0_GROUP(0xE, SDT)     | OP0_GROUP(0xF, UNKNOWN);
+
+_Static_assert(UNKNOWN < 16, "Instruction types must fit in a nibble of op0_groups");
+_Static_assert(LL == SDT + 1, "Load literal must follow SDT in InstructionType");
 
 InstructionType get_instruction_type(uint32_t instruction_word) {
     // Special case for the HALT instruction (defined in constants.h)
     if (instruction_word == HALT_INSTRUCTION) return HALT;
 
-    uint32_t op0 = get_bits(instruction_word, 25, 28);
-
-    // Mask out don't care bits and compare against given patterns
-    // op0:     Group:
-    // 100x    Data Processing (Immediate)
-    // x101    Data Processing (Register)
-    // x1x0    Loads and Stores
-    // 101x    Branches
-    if ((op0 & 0xE) == 0x8) {
-        return DP_IMM;
-    } else if ((op0 & 0x7) == 0x5) {
-        return DP_REG;
-    } else if ((op0 & 0x5) == 0x4) {
-        // SDT/LL share the same op0 pattern, use the MSB to differentiate
-        return (instruction_word & (1 << 31)) ? SDT : LL;
-    } else if ((op0 & 0xE) == 0xA) {
-        return BRANCH;
+    unsigned type = (op0_groups >> (4 * ((instruction_word >> 25) & 0xF))) & 0xF;
+    // SDT/LL share the same op0 pattern, the MSB tells them apart
+    type += (type == SDT) & !(instruction_word >> 31);
+    return (InstructionType)type;
+}
+
+// The decoded instruction is assembled in two 64-bit words and copied out once:
+// storing fields one byte at a time into the returned struct stalls the 16-byte
+// load that reads it back. Fields absent from a format are selected to 0 rather
+// than branched around, so the only data-dependent branch is on the type.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "decode_instruction packs fields assuming a little-endian host"
+#endif
+_Static_assert(sizeof(DecodedInstruction) <= 2 * sizeof(uint64_t), "DecodedInstruction is packed into two words");
+
+// Aligned members never straddle the two words; signed values are passed already
+// truncated to their member's width
+#define PUT(packed, member, value) \
+    ((packed)[offsetof(DecodedInstruction, member) / 8] |= \
+        (uint64_t)(value) << (8 * (offsetof(DecodedInstruction, member) % 8)))
+
+// Decodes the fields of w, already classified as type; reports nothing
+static inline DecodedInstruction decode_fields(uint32_t w, unsigned type) {
+    uint64_t packed[2] = { 0, 0 };
+    PUT(packed, type, type);
+
+    // Populate the fields of the appropriate format based on the instruction type
+    if (type == DP_IMM) {
+        unsigned opi = field_opi(w);
+        bool arithmetic = opi == 0x2, wide_move = opi == 0x5;
+        PUT(packed, sf, field_sf(w));
+        PUT(packed, dp_imm.opc, field_opc(w));
+        PUT(packed, dp_imm.opi, opi);
+        PUT(packed, dp_imm.rd, field_rd(w));
+        PUT(packed, dp_imm.sh, arithmetic ? field_sh(w) : 0);
+        PUT(packed, dp_imm.rn, arithmetic ? field_rn(w) : 0);
+        PUT(packed, dp_imm.hw, wide_move ? field_hw(w) : 0);
+        PUT(packed, dp_imm.imm, arithmetic ? field_imm12(w) : wide_move ? field_imm16(w) : 0);
+    } else if (type == DP_REG) {
+        bool multiply = field_M(w);
+        PUT(packed, sf, field_sf(w));
+        PUT(packed, dp_reg.opc, field_opc(w));
+        PUT(packed, dp_reg.M, multiply);
+        PUT(packed, dp_reg.opr, field_opr(w));
+        PUT(packed, dp_reg.rm, field_rm(w));
+        PUT(packed, dp_reg.shift_amount, field_imm6(w));
+        PUT(packed, dp_reg.rn, field_rn(w));
+        PUT(packed, dp_reg.rd, field_rd(w));
+        PUT(packed, dp_reg.x, multiply ? field_x(w) : 0);
+        PUT(packed, dp_reg.ra, multiply ? field_ra(w) : 0);
+        PUT(packed, dp_reg.shift_type, multiply ? 0 : field_shift(w));
+        PUT(packed, dp_reg.N, multiply ? 0 : field_N(w));
+    } else if (type == SDT) {
+        // U == 1: Unsigned offset
+        // U == 0 and bit 21 is 1: Register offset
+        // U == 0 and bit 21 is 0: Pre/Post-indexing (I == 1: pre, I == 0: post)
+        bool unsigned_offset = field_U(w);
+        bool register_offset = !unsigned_offset && field_offset_register(w);
+        bool indexed = !unsigned_offset && !register_offset;
+        unsigned mode = unsigned_offset ? UNSIGNED_IMMEDIATE
+                      : register_offset ? REGISTER_OFFSET
+                      : field_I(w)      ? PRE_INDEXED : POST_INDEXED;
+        PUT(packed, sf, field_size(w));
+        PUT(packed, sdt.L, field_L(w));
+        PUT(packed, sdt.xn, field_rn(w));
+        PUT(packed, sdt.rt, field_rd(w));
+        PUT(packed, sdt.mode, mode);
+        PUT(packed, sdt.imm12, unsigned_offset ? field_imm12(w) : 0);
+        PUT(packed, sdt.xm, register_offset ? field_xm(w) : 0);
+        PUT(packed, sdt.simm9, indexed ? (uint16_t)sign_extend(field_simm9(w), 9) : 0);
+    } else if (type == LL) {
+        PUT(packed, sf, field_size(w));
+        PUT(packed, ll.simm19, (uint32_t)sign_extend(field_simm19(w), 19));
+        PUT(packed, ll.rt, field_rd(w));
+    } else if (type == BRANCH) {
+        // 00: unconditional, 01: conditional, 11: register
+        unsigned group = field_group(w);
+        int32_t offset = group == 0 ? sign_extend(field_simm26(w), 26)
+                       : group == 1 ? sign_extend(field_simm19(w), 19) : 0;
+        PUT(packed, branch.group, group);
+        PUT(packed, branch.xn, group == 0 || group == 3 ? field_rn(w) : 0);
+        PUT(packed, branch.cond, group == 1 ? field_cond(w) : 0);
+        PUT(packed, branch.offset, (uint32_t)offset);
     } else {
-        return UNKNOWN;
+        // No fields to decode for HALT or UNKNOWN, keep the word for diagnostics
+        PUT(packed, raw_instruction, w);
+    }
+
+    DecodedInstruction i;
+    memcpy(&i, packed, sizeof(DecodedInstruction));
+    return i;
+}
+
+DecodedInstruction decode_instruction(uint32_t instruction_word) {
+    DecodedInstruction i = decode_fields(instruction_word, get_instruction_type(instruction_word));
+    if (i.type == BRANCH && i.branch.group == 2) {
+        fprintf(stderr, "Error: Invalid branch instruction format\n");
     }
+    return i;
 }
 
-int64_t sign_extend(uint32_t value, uint8_t bits) {
-    // Sign-extend the first `bits` bits of `value` to 64b
-    if (value & (1U << (bits - 1))) {
-        // If the sign bit is set, extend the sign
-        return value | ((int64_t)-1 << bits);
-    } else {
-        // If the sign bit is not set, just return the value
-        return value;
+// --- Bulk decoding ---
+
+// The op0 table as masked comparisons, one per group (the groups are disjoint), so
+// a vector of words is classified with a handful of compares per group
+#define DP_IMM_MASK 0x1C000000U // op0 100x
+#define DP_IMM_BITS 0x10000000U
+#define DP_REG_MASK 0x0E000000U // op0 x101
+#define DP_REG_BITS 0x0A000000U
+#define SDT_MASK    0x0A000000U // op0 x1x0
+#define SDT_BITS    0x08000000U
+#define BRANCH_MASK 0x1C000000U // op0 101x
+#define BRANCH_BITS 0x14000000U
+
+// Words classified per step
+#define CLASSIFY_WIDTH 8
+
+#if defined(__AVX2__)
+static inline void classify_words(const uint32_t* words, uint32_t* types) {
+    __m256i w = _mm256_loadu_si256((const __m256i*)words);
+#define MATCHES(mask, bits) \
+    _mm256_cmpeq_epi32(_mm256_and_si256(w, _mm256_set1_epi32((int)(mask))), _mm256_set1_epi32((int)(bits)))
+    __m256i dp_imm = MATCHES(DP_IMM_MASK, DP_IMM_BITS);
+    __m256i dp_reg = MATCHES(DP_REG_MASK, DP_REG_BITS);
+    __m256i sdt = MATCHES(SDT_MASK, SDT_BITS);
+    __m256i branch = MATCHES(BRANCH_MASK, BRANCH_BITS);
+#undef MATCHES
+    __m256i halt = _mm256_cmpeq_epi32(w, _mm256_set1_epi32((int)HALT_INSTRUCTION));
+    __m256i any = _mm256_or_si256(_mm256_or_si256(dp_imm, dp_reg), _mm256_or_si256(sdt, branch));
+
+    // DP_IMM is 0, so its lanes need no term; a clear MSB turns SDT into LL
+    __m256i transfer = _mm256_sub_epi32(_mm256_set1_epi32(LL), _mm256_srli_epi32(w, 31));
+    __m256i type = _mm256_and_si256(dp_reg, _mm256_set1_epi32(DP_REG));
+    type = _mm256_or_si256(type, _mm256_and_si256(sdt, transfer));
+    type = _mm256_or_si256(type, _mm256_and_si256(branch, _mm256_set1_epi32(BRANCH)));
+    type = _mm256_or_si256(type, _mm256_andnot_si256(any, _mm256_set1_epi32(UNKNOWN)));
+    type = _mm256_blendv_epi8(type, _mm256_set1_epi32(HALT), halt);
+    _mm256_storeu_si256((__m256i*)types, type);
+}
+#elif defined(__SSE2__)
+static inline __m128i classify_vector(__m128i w) {
+#define MATCHES(mask, bits) \
+    _mm_cmpeq_epi32(_mm_and_si128(w, _mm_set1_epi32((int)(mask))), _mm_set1_epi32((int)(bits)))
+    __m128i dp_imm = MATCHES(DP_IMM_MASK, DP_IMM_BITS);
+    __m128i dp_reg = MATCHES(DP_REG_MASK, DP_REG_BITS);
+    __m128i sdt = MATCHES(SDT_MASK, SDT_BITS);
+    __m128i branch = MATCHES(BRANCH_MASK, BRANCH_BITS);
+#undef MATCHES
+    __m128i halt = _mm_cmpeq_epi32(w, _mm_set1_epi32((int)HALT_INSTRUCTION));
+    __m128i any = _mm_or_si128(_mm_or_si128(dp_imm, dp_reg), _mm_or_si128(sdt, branch));
+
+    // DP_IMM is 0, so its lanes need no term; a clear MSB turns SDT into LL
+    __m128i transfer = _mm_sub_epi32(_mm_set1_epi32(LL), _mm_srli_epi32(w, 31));
+    __m128i type = _mm_and_si128(dp_reg, _mm_set1_epi32(DP_REG));
+    type = _mm_or_si128(type, _mm_and_si128(sdt, transfer));
+    type = _mm_or_si128(type, _mm_and_si128(branch, _mm_set1_epi32(BRANCH)));
+    type = _mm_or_si128(type, _mm_andnot_si128(any, _mm_set1_epi32(UNKNOWN)));
+    return _mm_or_si128(_mm_andnot_si128(halt, type), _mm_and_si128(halt, _mm_set1_epi32(HALT)));
+}
+
+static inline void classify_words(const uint32_t* words, uint32_t* types) {
+    _mm_storeu_si128((__m128i*)types, classify_vector(_mm_loadu_si128((const __m128i*)words)));
+    _mm_storeu_si128((__m128i*)(types + 4), classify_vector(_mm_loadu_si128((const __m128i*)(words + 4))));
+}
+#else
+static inline void classify_words(const uint32_t* words, uint32_t* types) {
+    for (unsigned k = 0; k < CLASSIFY_WIDTH; k++) types[k] = get_instruction_type(words[k]);
+}
+#endif
+
+void decode_block(const uint32_t* words, size_t count, DecodedInstruction* decoded) {
+    size_t k = 0;
+    uint32_t types[CLASSIFY_WIDTH];
+    for (; k + CLASSIFY_WIDTH <= count; k += CLASSIFY_WIDTH) {
+        classify_words(&words[k], types);
+        for (unsigned lane = 0; lane < CLASSIFY_WIDTH; lane++) {
+            decoded[k + lane] = decode_fields(words[k + lane], types[lane]);
+        }
     }
-}
\ No newline at end of file
+    for (; k < count; k++) {
+        decoded[k] = decode_fields(words[k], get_instruction_type(words[k]));
+    }
+}
@@ -2,11 +2,19 @@
 #define DECODER_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "arm_state.h"
 #include "instruction_types.h"
 
+// Table-driven decoder: the group comes from a 16-entry op0 table and every field
+// is extracted with a constant mask
 DecodedInstruction decode_instruction(uint32_t instruction_word);
-uint32_t get_bits(uint32_t value, uint8_t start, uint8_t end);
 InstructionType get_instruction_type(uint32_t instruction_word);
 
+// Decodes count words into decoded[0..count), classifying eight words at a time with
+// SSE2 or AVX2 when the build targets them. Equivalent to decode_instruction on every
+// word, except that it reports nothing: a loaded image is mostly decoded ahead of
+// execution and may hold data that does not decode cleanly.
+void decode_block(const uint32_t* words, size_t count, DecodedInstruction* decoded);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "decoder_reference.h"
+
+static uint32_t get_bits(uint32_t value, uint8_t start, uint8_t end);
+static InstructionType get_instruction_type(uint32_t instruction_word);
+static int64_t sign_extend(uint32_t value, uint8_t bits);
+static DecodedInstruction decode(uint32_t instruction_word, bool report_invalid);
+
+DecodedInstruction decode_instruction_reference(uint32_t instruction_word) {
+    return decode(instruction_word, true);
+}
+
+DecodedInstruction decode_fields_reference(uint32_t instruction_word) {
+    return decode(instruction_word, false);
+}
+
+static DecodedInstruction decode(uint32_t instruction_word, bool report_invalid) {
+    DecodedInstruction i;
+
+    memset(&i, 0, sizeof(DecodedInstruction));  // Initialize all fields to zero
+    i.type = get_instruction_type(instruction_word);
+
+    // Populate the fields of the appropriate format based on the instruction type
+    switch (i.type) {
+        case DP_IMM: {
+            i.sf = get_bits(instruction_word, 31, 31);
+            i.dp_imm.opc = get_bits(instruction_word, 29, 30);
+            i.dp_imm.opi = get_bits(instruction_word, 23, 25);
+            i.dp_imm.rd = get_bits(instruction_word, 0, 4);
+
+            if (i.dp_imm.opi == 0x2) {  // Arithmetic operation
+                i.dp_imm.sh = get_bits(instruction_word, 22, 22);
+                i.dp_imm.imm = get_bits(instruction_word, 10, 21);
+                i.dp_imm.rn = get_bits(instruction_word, 5, 9);
+            } else if (i.dp_imm.opi == 0x5) {  // Wide move
+                i.dp_imm.hw = get_bits(instruction_word, 21, 22);
+                i.dp_imm.imm = get_bits(instruction_word, 5, 20);
+            }
+
+            break;
+        }
+        case DP_REG: {
+            i.sf = get_bits(instruction_word, 31, 31);
+            i.dp_reg.opc = get_bits(instruction_word, 29, 30);
+            i.dp_reg.M = get_bits(instruction_word, 28, 28);
+            i.dp_reg.opr = get_bits(instruction_word, 21, 24);
+            i.dp_reg.rm = get_bits(instruction_word, 16, 20);
+            i.dp_reg.shift_amount = get_bits(instruction_word, 10, 15);
+            i.dp_reg.rn = get_bits(instruction_word, 5, 9);
+            i.dp_reg.rd = get_bits(instruction_word, 0, 4);
+
+            if (i.dp_reg.M) {  // Multiply operation
+                i.dp_reg.x = get_bits(instruction_word, 15, 15);
+                i.dp_reg.ra = get_bits(instruction_word, 10, 14);
+            } else {  // Arithmetic or Logical operation
+                i.dp_reg.shift_type = get_bits(instruction_word, 22, 23);
+                i.dp_reg.N = get_bits(instruction_word, 21, 21);
+            }
+
+            break;
+        }
+        case SDT: {
+            i.sf = get_bits(instruction_word, 30, 30);
+            i.sdt.L = get_bits(instruction_word, 22, 22);
+            i.sdt.xn = get_bits(instruction_word, 5, 9);
+            i.sdt.rt = get_bits(instruction_word, 0, 4);
+
+            // Determine the type of offset based on the instruction format
+            // U == 1: Unsigned offset
+            // U == 0 and bit 21 is 1: Register offset
+            // U == 0 and bit 21 is 0: Pre/Post-indexing (I == 1: pre, I == 0: post)
+            if (get_bits(instruction_word, 24, 24)) {  // Unsigned offset
+                i.sdt.mode = UNSIGNED_IMMEDIATE;
+                i.sdt.imm12 = get_bits(instruction_word, 10, 21);
+            } else if (get_bits(instruction_word, 21, 21)) {  // Register offset
+                i.sdt.mode = REGISTER_OFFSET;
+                i.sdt.xm = get_bits(instruction_word, 16, 20);
+            } else {  // Pre/Post-indexing
+                i.sdt.mode = get_bits(instruction_word, 11, 11) ? PRE_INDEXED : POST_INDEXED;
+                i.sdt.simm9 = (int16_t)sign_extend(get_bits(instruction_word, 12, 20), 9);
+            }
+
+            break;
+        }
+        case LL: {
+            i.sf = get_bits(instruction_word, 30, 30);
+            // Sign-extend to 32 bits
+            i.ll.simm19 = (int32_t)sign_extend(get_bits(instruction_word, 5, 23), 19);
+            i.ll.rt = get_bits(instruction_word, 0, 4);
+            break;
+        }
+        case BRANCH: {
+            // Compare the two most significant bits to determine the branch type
+            i.branch.group = get_bits(instruction_word, 30, 31);
+            switch (i.branch.group) {
+                case 0: {  // Unconditional branch (00)
+                    i.branch.offset = (int32_t)sign_extend(get_bits(instruction_word, 0, 25), 26);
+                    i.branch.xn = get_bits(instruction_word, 5, 9);
+                    break;
+                }
+                case 3: {  // Register branch (11)
+                    i.branch.xn = get_bits(instruction_word, 5, 9);
+                    break;
+                }
+                case 1: {  // Conditional branch (01)
+                    i.branch.cond = get_bits(instruction_word, 0, 3);
+                    i.branch.offset = (int32_t)sign_extend(get_bits(instruction_word, 5, 23), 19);
+                    break;
+                }
+                default: {
+                    if (report_invalid) fprintf(stderr, "Error: Invalid branch instruction format\n");
+                    break;
+                }
+            }
+            break;
+        }
+        case HALT:
+        case UNKNOWN: {
+            // No fields to decode for HALT or UNKNOWN, keep the word for diagnostics
+            i.raw_instruction = instruction_word;
+            break;
+        }
+        default: {
+            fprintf(stderr, "Error: Unknown instruction type %d\n", i.type);
+            break;
+        }
+    }
+    return i;
+}
+
+static uint32_t get_bits(uint32_t value, uint8_t start, uint8_t end) {
+    // Extract bits from start index to end index (inclusive)
+    return (value >> start) & ((1U << (end - start + 1)) - 1);
+}
+
+static InstructionType get_instruction_type(uint32_t instruction_word) {
+    // Special case for the HALT instruction (defined in constants.h)
+    if (instruction_word == HALT_INSTRUCTION) return HALT;
+
+    uint32_t op0 = get_bits(instruction_word, 25, 28);
+
+    // Mask out don't care bits and compare against given patterns
+    // op0:     Group:
+    // 100x    Data Processing (Immediate)
+    // x101    Data Processing (Register)
+    // x1x0    Loads and Stores
+    // 101x    Branches
+    if ((op0 & 0xE) == 0x8) {
+        return DP_IMM;
+    } else if ((op0 & 0x7) == 0x5) {
+        return DP_REG;
+    } else if ((op0 & 0x5) == 0x4) {
+        // SDT/LL share the same op0 pattern, use the MSB to differentiate
+        return (instruction_word & (1 << 31)) ? SDT : LL;
+    } else if ((op0 & 0xE) == 0xA) {
+        return BRANCH;
+    } else {
+        return UNKNOWN;
+    }
+}
+
+static int64_t sign_extend(uint32_t value, uint8_t bits) {
+    // Sign-extend the first `bits` bits of `value` to 64b
+    if (value & (1U << (bits - 1))) {
+        // If the sign bit is set, extend the sign
+        return value | ((int64_t)-1 << bits);
+    } else {
+        // If the sign bit is not set, just return the value
+        return value;
+    }
+}
\ No newline at end of file
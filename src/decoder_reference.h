@@ -0,0 +1,18 @@
+#ifndef DECODER_REFERENCE_H
+#define DECODER_REFERENCE_H
+
+#include <stdint.h>
+#include "arm_state.h"
+#include "instruction_types.h"
+
+// Straightforward decoder that extracts every field with get_bits and classifies
+// words with a chain of masked comparisons. It is not linked into the emulator:
+// the decoder benchmark measures decode_instruction against it and checks that
+// both produce the same DecodedInstruction.
+DecodedInstruction decode_instruction_reference(uint32_t instruction_word);
+
+// The same without the stderr diagnostic for invalid (group 2) branches, to check
+// decode_block against, which does not report them either
+DecodedInstruction decode_fields_reference(uint32_t instruction_word);
+
+#endif
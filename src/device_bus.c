@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "device_bus.h"
+
+void device_bus_init(DeviceBus* bus) {
+    bus->count = 0;
+}
+
+bool device_bus_add(DeviceBus* bus, uint64_t base, uint64_t size, DeviceRead read, DeviceWrite write, void* context) {
+    if (bus->count == MAX_DEVICES || size == 0 || base < MEMORY_PAGE_SIZE || size > UINT64_MAX - base) {
+        return false;
+    }
+    uint64_t end = base + size;
+
+    // Insertion sort: the new device goes before the first one above it
+    unsigned slot = 0;
+    while (slot < bus->count && bus->devices[slot].base < base) slot++;
+    if ((slot > 0 && bus->devices[slot - 1].end > base) || (slot < bus->count && bus->devices[slot].base < end)) {
+        return false;
+    }
+    memmove(&bus->devices[slot + 1], &bus->devices[slot], (bus->count - slot) * sizeof(Device));
+    bus->devices[slot] = (Device){ .base = base, .end = end, .read = read, .write = write, .context = context };
+    bus->count++;
+    return true;
+}
+
+const Device* device_bus_find(const DeviceBus* bus, uint64_t address) {
+    unsigned low = 0, high = bus->count;
+    while (low < high) {
+        unsigned middle = (low + high) / 2;
+        const Device* device = &bus->devices[middle];
+        if (address < device->base) {
+            high = middle;
+        } else if (address >= device->end) {
+            low = middle + 1;
+        } else {
+            return device;
+        }
+    }
+    return NULL;
+}
+
+void attach_device_bus(ARMState* state, DeviceBus* bus) {
+    state->devices = bus;
+    state->ram_end = state->memory_size;
+    if (bus->count > 0 && bus->devices[0].base < state->ram_end) {
+        state->ram_end = bus->devices[0].base;
+    }
+}
+
+// Does [address, address + width) lie partly in a device and partly outside it (in
+// RAM, nothing, or another device)? Such an access is neither a register access nor
+// a RAM one. *device is set to the device claiming its first byte, if any.
+static bool straddles_device(const ARMState* state, uint64_t address, unsigned width, const Device** device) {
+    *device = NULL;
+    if (state->devices == NULL) return false;
+    uint64_t last = address + (width - 1);
+    if (last < address) last = UINT64_MAX; // Wraps around: faults as RAM anyway
+    *device = device_bus_find(state->devices, address);
+    return device_bus_find(state->devices, last) != *device;
+}
+
+static uint64_t straddle_fault(const ARMState* state, uint64_t address, unsigned width) {
+    fprintf(stderr, "Error: Memory access at 0x%" PRIx64 " (%u bytes, PC 0x%016" PRIx64 ") crosses a device boundary\n",
+            address, width, state->pc);
+    return 0;
+}
+
+// Past ram_end there is either a device, RAM between or above devices, or nothing
+uint64_t memory_read_slow(const ARMState* state, uint64_t address, unsigned width) {
+    const Device* device;
+    if (straddles_device(state, address, width, &device)) return straddle_fault(state, address, width);
+    if (device) {
+        return device->read ? device->read(device->context, address, width) : 0;
+    }
+    if (!in_guest_memory(state, address, width)) return memory_fault(state, address, width);
+    return width == 8 ? load_le64(&state->memory[address]) : load_le32(&state->memory[address]);
+}
+
+bool memory_write_slow(ARMState* state, uint64_t address, unsigned width, uint64_t value) {
+    const Device* device;
+    if (straddles_device(state, address, width, &device)) {
+        straddle_fault(state, address, width);
+        return false;
+    }
+    if (device) {
+        if (device->write) device->write(device->context, address, width, value);
+        return false;
+    }
+    if (!in_guest_memory(state, address, width)) return memory_fault(state, address, width);
+    if (width == 8) {
+        store_le64(&state->memory[address], value);
+    } else {
+        store_le32(&state->memory[address], (uint32_t)value);
+    }
+    mark_dirty(state, address, width);
+    return true;
+}
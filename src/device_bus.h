@@ -0,0 +1,52 @@
+#ifndef DEVICE_BUS_H
+#define DEVICE_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "arm_state.h"
+
+// Memory-mapped devices. A device claims the guest addresses [base, end): loads and
+// stores that lie within it call its handlers instead of touching RAM, and those that
+// cross one of its bounds fault. Devices are
+// kept sorted by base, so the one claiming an address is found by binary search.
+//
+// Attaching a bus to a machine lowers its ram_end to the first device, so plain RAM
+// accesses stay a single compare (see memory_read32) and only those past ram_end
+// ever search the table.
+
+#define MAX_DEVICES 16
+
+// Handlers get the full guest address and the access width in bytes (4 or 8).
+// A device without a read handler reads as 0; without a write handler, stores to
+// it are dropped.
+typedef uint64_t (*DeviceRead)(void* context, uint64_t address, unsigned width);
+typedef void (*DeviceWrite)(void* context, uint64_t address, unsigned width, uint64_t value);
+
+typedef struct {
+    uint64_t base;
+    uint64_t end;
+    DeviceRead read;
+    DeviceWrite write;
+    void* context;
+} Device;
+
+struct DeviceBus {
+    Device devices[MAX_DEVICES]; // Sorted by base, never overlapping
+    unsigned count;
+};
+
+void device_bus_init(DeviceBus* bus);
+
+// Claims [base, base + size) for a device. Returns false if the table is full, or the
+// range is empty, overlaps another device or reaches into page 0 (which always holds
+// the image, and keeps ram_end at least a page).
+bool device_bus_add(DeviceBus* bus, uint64_t base, uint64_t size, DeviceRead read, DeviceWrite write, void* context);
+
+// The device claiming address, or NULL
+const Device* device_bus_find(const DeviceBus* bus, uint64_t address);
+
+// Routes state's loads and stores through bus. Add every device first: ram_end is
+// computed here.
+void attach_device_bus(ARMState* state, DeviceBus* bus);
+
+#endif
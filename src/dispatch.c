@@ -0,0 +1,86 @@
+#include "dispatch.h"
+#include "executor.h"
+#include "dp_executor.h"
+#include "dp_handlers.h"
+#include "mem_branch_executor.h"
+
+// --- Data processing (see dp_handlers.c for the specialized handlers) ---
+// Wide moves with the unallocated opc 01 keep the behaviour of the generic executor
+static bool handle_dp_imm_wide_move(ARMState* state, const DecodedInstruction* instr) {
+    execute_dp_imm_wide_move(state, instr);
+    return false;
+}
+
+// Unallocated opi values are ignored, as in execute_dp_instruction
+static bool handle_nop(ARMState* state, const DecodedInstruction* instr) {
+    (void)state;
+    (void)instr;
+    return false;
+}
+
+// --- Loads and stores ---
+static bool handle_load(ARMState* state, const DecodedInstruction* instr) {
+    execute_ldr(state, (addressing_mode)instr->sdt.mode, instr);
+    return false;
+}
+
+static bool handle_store(ARMState* state, const DecodedInstruction* instr) {
+    execute_str(state, (addressing_mode)instr->sdt.mode, instr);
+    return false;
+}
+
+static bool handle_load_literal(ARMState* state, const DecodedInstruction* instr) {
+    execute_ldr(state, LOAD_LITERAL, instr);
+    return false;
+}
+
+// --- Branches ---
+static bool handle_branch(ARMState* state, const DecodedInstruction* instr) {
+    execute_branch_unconditional(state, instr->branch.offset);
+    return true;
+}
+
+static bool handle_branch_register(ARMState* state, const DecodedInstruction* instr) {
+    execute_branch_register(state, instr->branch.xn);
+    return true;
+}
+
+static bool handle_branch_cond(ARMState* state, const DecodedInstruction* instr) {
+    if (!condition_holds(state, instr->branch.cond)) {
+        return false;
+    }
+    execute_branch_unconditional(state, instr->branch.offset);
+    return true;
+}
+
+// --- HALT and anything else keeps the diagnostics of execute_instruction ---
+static bool handle_fallback(ARMState* state, const DecodedInstruction* instr) {
+    return execute_instruction(state, instr);
+}
+
+InstructionHandler resolve_handler(const DecodedInstruction* instr) {
+    switch (instr->type) {
+        case DP_IMM:
+        case DP_REG: {
+            InstructionHandler specialized = resolve_dp_handler(instr);
+            if (specialized) return specialized;
+            if (instr->type == DP_IMM && instr->dp_imm.opi == 0x5) return handle_dp_imm_wide_move;
+            return handle_nop;
+        }
+        case SDT:
+            return instr->sdt.L ? handle_load : handle_store;
+        case LL:
+            return handle_load_literal;
+        case BRANCH:
+            switch (instr->branch.group) {
+                case 0: return handle_branch;
+                case 1: return handle_branch_cond;
+                case 3: return handle_branch_register;
+                default: return handle_fallback;
+            }
+        case HALT:
+        case UNKNOWN:
+        default:
+            return handle_fallback;
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include <stdbool.h>
+#include "arm_state.h"
+#include "instruction_types.h"
+
+// Threaded-code dispatch.
+// Each decoded instruction is bound to the handler for its exact operation when it
+// is decoded, so executing it is a single indirect call instead of the nested
+// switches in execute_instruction. Handlers follow the execute_instruction
+// contract: they return true if the PC was modified (or execution must stop)
+// and false if the caller should advance the PC by 4.
+typedef bool (*InstructionHandler)(ARMState* state, const DecodedInstruction* instr);
+
+// Selects the handler for a decoded instruction
+InstructionHandler resolve_handler(const DecodedInstruction* instr);
+
+#endif
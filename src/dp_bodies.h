@@ -0,0 +1,121 @@
+#ifndef DP_BODIES_H
+#define DP_BODIES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "arm_state.h"
+#include "instruction_types.h"
+#include "dp_executor.h"
+#include "shifts.h"
+
+// Generic data processing bodies shared by the specialized handlers in
+// dp_handlers.c and the fused ones in fusion.c. Callers pass compile-time
+// constant operation, sf, shift type and sets-flags arguments so the tests on
+// them fold away. They match the generic executors in dp_executor.c and shifts.c
+// bit for bit, including how 32-bit results reach update_flags.
+
+static inline uint64_t read_reg(const ARMState* state, uint8_t reg, bool sf) {
+    uint64_t value = state->registers[register_read_slot(reg)]; // ZR reads as 0
+    return sf ? value : (uint32_t)value;
+}
+
+static inline void write_reg(ARMState* state, uint8_t reg, uint64_t value, bool sf) {
+    state->registers[register_write_slot(reg)] = sf ? value : (uint32_t)value; // ZR writes are sunk
+}
+
+// execute_shift for a value already read at width sf
+static inline uint64_t shift_operand(uint64_t value, uint8_t amount, ShiftType type, bool sf) {
+    unsigned bits = sf ? 64 : 32;
+    uint64_t result;
+    switch (type) {
+        case SHIFT_LSL:
+            result = value << amount;
+            break;
+        case SHIFT_LSR:
+            result = value >> amount;
+            break;
+        case SHIFT_ASR:
+            // Shifting a 32-bit value by 32 or more leaves only copies of its sign bit
+            result = sf ? (uint64_t)((int64_t)value >> amount)
+                        : (uint32_t)((int32_t)(uint32_t)value >> (amount > 31 ? 31 : amount));
+            break;
+        case SHIFT_ROR:
+        default:
+            amount %= bits;
+            result = amount == 0 ? value : (value >> amount) | (value << (bits - amount));
+            break;
+    }
+    return sf ? result : (uint32_t)result;
+}
+
+static inline void dp_imm_arithmetic(ARMState* state, const DecodedInstruction* instr, bool subtract,
+                                     FlagUpdate flags, bool sf) {
+    uint64_t operand1 = read_reg(state, instr->dp_imm.rn, sf);
+    uint64_t immediate = (uint64_t)instr->dp_imm.imm << (12 * instr->dp_imm.sh);
+    // Like execute_dp_imm_arithmetic, 32-bit flags see the untruncated result
+    uint64_t result = subtract ? operand1 - immediate : operand1 + immediate;
+    write_reg(state, instr->dp_imm.rd, result, sf);
+    if (flags != FLAGS_NONE) {
+        update_flags(state, result, operand1, immediate, flags, sf);
+    }
+}
+
+static inline void dp_imm_wide_move(ARMState* state, const DecodedInstruction* instr, uint8_t opc, bool sf) {
+    uint8_t hw_shift = instr->dp_imm.hw * 16;
+    uint64_t operand = (uint64_t)instr->dp_imm.imm << hw_shift;
+    uint64_t result;
+    switch (opc) {
+        case 0x0: // MOVN
+            result = sf ? ~operand : (uint32_t)~operand;
+            break;
+        case 0x2: // MOVZ
+            result = operand;
+            break;
+        case 0x3: // MOVK
+        default: {
+            uint64_t mask = (sf ? 0xFFFFULL : 0xFFFFU) << hw_shift;
+            result = (read_reg(state, instr->dp_imm.rd, sf) & ~mask) | operand;
+            break;
+        }
+    }
+    write_reg(state, instr->dp_imm.rd, result, sf);
+}
+
+// opc: 00 AND, 01 ORR, 10 EOR, 11 ANDS; invert (N) turns them into BIC, ORN, EON, BICS
+static inline void dp_reg_logical(ARMState* state, const DecodedInstruction* instr, uint8_t opc, bool invert,
+                                  bool sets_flags, ShiftType type, bool sf) {
+    uint64_t operand1 = read_reg(state, instr->dp_reg.rn, sf);
+    uint64_t operand2 = shift_operand(read_reg(state, instr->dp_reg.rm, sf), instr->dp_reg.shift_amount, type, sf);
+    if (invert) {
+        operand2 = sf ? ~operand2 : (uint32_t)~operand2;
+    }
+    uint64_t result = opc == 0x1 ? operand1 | operand2 : opc == 0x2 ? operand1 ^ operand2 : operand1 & operand2;
+    if (sets_flags) {
+        update_flags(state, result, operand1, operand2, FLAGS_LOGICAL, sf);
+    }
+    write_reg(state, instr->dp_reg.rd, result, sf);
+}
+
+// opc: 00 ADD, 01 ADDS, 10 SUB, 11 SUBS; ADD and SUB set N and Z when rd is ZR
+static inline void dp_reg_arithmetic(ARMState* state, const DecodedInstruction* instr, uint8_t opc,
+                                     bool sets_flags, ShiftType type, bool sf) {
+    uint64_t operand1 = read_reg(state, instr->dp_reg.rn, sf);
+    uint64_t operand2 = shift_operand(read_reg(state, instr->dp_reg.rm, sf), instr->dp_reg.shift_amount, type, sf);
+    uint64_t result = (opc & 0x2) ? operand1 - operand2 : operand1 + operand2;
+    if (!sf) result = (uint32_t)result;
+    write_reg(state, instr->dp_reg.rd, result, sf);
+    if (sets_flags) {
+        FlagUpdate kind = (opc == 0x1) ? FLAGS_ADDS : (opc == 0x3) ? FLAGS_SUBS : FLAGS_NZ;
+        update_flags(state, result, operand1, operand2, kind, sf);
+    }
+}
+
+static inline void dp_reg_multiply(ARMState* state, const DecodedInstruction* instr, bool subtract, bool sf) {
+    uint64_t operand1 = read_reg(state, instr->dp_reg.rn, sf);
+    uint64_t operand2 = read_reg(state, instr->dp_reg.rm, sf);
+    uint64_t product = sf ? operand1 * operand2 : (uint64_t)((uint32_t)operand1 * (uint32_t)operand2);
+    uint64_t accumulator = read_reg(state, instr->dp_reg.ra, sf);
+    write_reg(state, instr->dp_reg.rd, subtract ? accumulator - product : accumulator + product, sf);
+}
+
+#endif
@@ -6,6 +6,57 @@
 #include "shifts.h"            // For ShiftType enum and execute_shift function
 
 //Executes a decoded Data Processing (Immediate or Register) instruction.
-void execute_dp_instruction(ARMState* state, DecodedInstruction* instr);
+void execute_dp_instruction(ARMState* state, const DecodedInstruction* instr);
+
+// Per-operation entry points, used directly by the threaded dispatcher
+void execute_dp_imm_arithmetic(ARMState* state, const DecodedInstruction* instr); // opi == 010
+void execute_dp_imm_wide_move(ARMState* state, const DecodedInstruction* instr);  // opi == 101
+void execute_dp_reg_logical(ARMState* state, const DecodedInstruction* instr);    // M == 0, opr[3] == 0
+void execute_dp_reg_arithmetic(ARMState* state, const DecodedInstruction* instr); // M == 0, opr[3] == 1
+void execute_dp_reg_multiply(ARMState* state, const DecodedInstruction* instr);   // M == 1
+
+// How a flag-setting operation updates PSTATE
+typedef enum {
+    FLAGS_NONE,    // No operation pending (ARMState.last_flag_op only)
+    FLAGS_ADDS,    // N, Z, C (carry out), V (signed overflow)
+    FLAGS_SUBS,    // N, Z, C (no borrow), V (signed overflow)
+    FLAGS_LOGICAL, // N, Z, C and V cleared
+    FLAGS_NZ,      // N and Z only (ADD/SUB to ZR without S)
+} FlagUpdate;
+
+// Slow path of materialize_flags
+void compute_pending_flags(ARMState* state);
+
+// Brings nzcv up to date; call before reading any of N, Z, C or V
+static inline void materialize_flags(ARMState* state) {
+    if (state->last_flag_op.kind != FLAGS_NONE) {
+        compute_pending_flags(state);
+    }
+}
+
+// Sets PSTATE from the result and operands of a flag-setting operation
+// (sf selects the sign bit used for N). Shared with the translated code.
+// The flags are computed lazily: this only records the operation, replacing the
+// previous one, and materialize_flags computes them once they are read.
+static inline void update_flags(ARMState* state, uint64_t result, uint64_t op1, uint64_t op2,
+                                FlagUpdate kind, bool sf) {
+    // FLAGS_NZ keeps C and V, so those of a still pending operation are needed first
+    if (kind == FLAGS_NZ) {
+        materialize_flags(state);
+    }
+    state->last_flag_op.result = result;
+    state->last_flag_op.op1 = op1;
+    state->last_flag_op.op2 = op2;
+    state->last_flag_op.kind = (uint8_t)kind;
+    state->last_flag_op.sf = sf;
+}
+
+// Z without materializing the other flags (every kind sets Z from the result)
+static inline bool zero_flag(const ARMState* state) {
+    if (state->last_flag_op.kind != FLAGS_NONE) {
+        return state->last_flag_op.result == 0;
+    }
+    return state->nzcv & FLAG_Z;
+}
 
 #endif
\ No newline at end of file
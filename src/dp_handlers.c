@@ -0,0 +1,155 @@
+#include "dp_handlers.h"
+#include "dp_bodies.h"
+
+// Every handler below is an instance of one of the generic bodies in dp_bodies.h.
+// The X-macro lists below generate the instances and the tables
+// resolve_dp_handler picks them from.
+
+// --- Instances ---
+
+// Dimensions: each expands X once per value, after the arguments of the outer ones
+#define DP_WIDTHS(X, ...) X(__VA_ARGS__, 32, false) X(__VA_ARGS__, 64, true)
+#define DP_SHIFTS(X, ...) \
+    X(__VA_ARGS__, lsl, SHIFT_LSL) X(__VA_ARGS__, lsr, SHIFT_LSR) \
+    X(__VA_ARGS__, asr, SHIFT_ASR) X(__VA_ARGS__, ror, SHIFT_ROR)
+#define DP_SETS_FLAGS(X, ...) X(__VA_ARGS__, keep, false) X(__VA_ARGS__, flags, true)
+
+// DP_IMM arithmetic: name, opc, subtract, flags
+#define DP_IMM_ARITHMETIC_OPS(X) \
+    X(add, 0x0, false, FLAGS_NONE) \
+    X(adds, 0x1, false, FLAGS_ADDS) \
+    X(sub, 0x2, true, FLAGS_NONE) \
+    X(subs, 0x3, true, FLAGS_SUBS)
+
+#define DEFINE_DP_IMM_ARITHMETIC(name, opc, subtract, flags, width, sf) \
+    static bool dp_imm_##name##_##width(ARMState* state, const DecodedInstruction* instr) { \
+        dp_imm_arithmetic(state, instr, subtract, flags, sf); \
+        return false; \
+    }
+#define DEFINE_DP_IMM_ARITHMETIC_OP(...) DP_WIDTHS(DEFINE_DP_IMM_ARITHMETIC, __VA_ARGS__)
+DP_IMM_ARITHMETIC_OPS(DEFINE_DP_IMM_ARITHMETIC_OP)
+
+#define DP_IMM_ARITHMETIC_ENTRY(name, opc, subtract, flags, width, sf) [sf] = dp_imm_##name##_##width,
+#define DP_IMM_ARITHMETIC_ROW(name, opc, ...) [opc] = { DP_WIDTHS(DP_IMM_ARITHMETIC_ENTRY, name, opc, __VA_ARGS__) },
+static const InstructionHandler dp_imm_arithmetic_handlers[4][2] = {
+    DP_IMM_ARITHMETIC_OPS(DP_IMM_ARITHMETIC_ROW)
+};
+
+// Wide moves: name, opc (01 is unallocated)
+#define DP_WIDE_MOVE_OPS(X) \
+    X(movn, 0x0) \
+    X(movz, 0x2) \
+    X(movk, 0x3)
+
+#define DEFINE_DP_WIDE_MOVE(name, opc, width, sf) \
+    static bool dp_imm_##name##_##width(ARMState* state, const DecodedInstruction* instr) { \
+        dp_imm_wide_move(state, instr, opc, sf); \
+        return false; \
+    }
+#define DEFINE_DP_WIDE_MOVE_OP(...) DP_WIDTHS(DEFINE_DP_WIDE_MOVE, __VA_ARGS__)
+DP_WIDE_MOVE_OPS(DEFINE_DP_WIDE_MOVE_OP)
+
+#define DP_WIDE_MOVE_ENTRY(name, opc, width, sf) [sf] = dp_imm_##name##_##width,
+#define DP_WIDE_MOVE_ROW(name, opc) [opc] = { DP_WIDTHS(DP_WIDE_MOVE_ENTRY, name, opc) },
+static const InstructionHandler dp_wide_move_handlers[4][2] = {
+    DP_WIDE_MOVE_OPS(DP_WIDE_MOVE_ROW)
+};
+
+// DP_REG logical: name, opc, N
+#define DP_LOGICAL_OPS(X) \
+    X(and, 0x0, 0) X(bic, 0x0, 1) \
+    X(orr, 0x1, 0) X(orn, 0x1, 1) \
+    X(eor, 0x2, 0) X(eon, 0x2, 1) \
+    X(ands, 0x3, 0) X(bics, 0x3, 1)
+
+#define DEFINE_DP_LOGICAL(name, opc, N, flags_name, sets_flags, width, sf, shift_name, shift) \
+    static bool dp_reg_##name##_##flags_name##_##width##_##shift_name(ARMState* state, \
+                                                                      const DecodedInstruction* instr) { \
+        dp_reg_logical(state, instr, opc, N, sets_flags, shift, sf); \
+        return false; \
+    }
+#define DEFINE_DP_LOGICAL_WIDTH(...) DP_SHIFTS(DEFINE_DP_LOGICAL, __VA_ARGS__)
+#define DEFINE_DP_LOGICAL_FLAGS(...) DP_WIDTHS(DEFINE_DP_LOGICAL_WIDTH, __VA_ARGS__)
+#define DEFINE_DP_LOGICAL_OP(...) DP_SETS_FLAGS(DEFINE_DP_LOGICAL_FLAGS, __VA_ARGS__)
+DP_LOGICAL_OPS(DEFINE_DP_LOGICAL_OP)
+
+#define DP_LOGICAL_ENTRY(name, opc, N, flags_name, sets_flags, width, sf, shift_name, shift) \
+    [shift] = dp_reg_##name##_##flags_name##_##width##_##shift_name,
+#define DP_LOGICAL_WIDTH_ROW(name, opc, N, flags_name, sets_flags, width, sf) \
+    [sf] = { DP_SHIFTS(DP_LOGICAL_ENTRY, name, opc, N, flags_name, sets_flags, width, sf) },
+#define DP_LOGICAL_FLAGS_ROW(name, opc, N, flags_name, sets_flags) \
+    [sets_flags] = { DP_WIDTHS(DP_LOGICAL_WIDTH_ROW, name, opc, N, flags_name, sets_flags) },
+#define DP_LOGICAL_ROW(name, opc, N) [(opc) * 2 + (N)] = { DP_SETS_FLAGS(DP_LOGICAL_FLAGS_ROW, name, opc, N) },
+static const InstructionHandler dp_logical_handlers[8][2][2][4] = {
+    DP_LOGICAL_OPS(DP_LOGICAL_ROW)
+};
+
+// DP_REG arithmetic: name, opc
+#define DP_ARITHMETIC_OPS(X) \
+    X(add, 0x0) \
+    X(adds, 0x1) \
+    X(sub, 0x2) \
+    X(subs, 0x3)
+
+#define DEFINE_DP_ARITHMETIC(name, opc, flags_name, sets_flags, width, sf, shift_name, shift) \
+    static bool dp_reg_##name##_##flags_name##_##width##_##shift_name(ARMState* state, \
+                                                                      const DecodedInstruction* instr) { \
+        dp_reg_arithmetic(state, instr, opc, sets_flags, shift, sf); \
+        return false; \
+    }
+#define DEFINE_DP_ARITHMETIC_WIDTH(...) DP_SHIFTS(DEFINE_DP_ARITHMETIC, __VA_ARGS__)
+#define DEFINE_DP_ARITHMETIC_FLAGS(...) DP_WIDTHS(DEFINE_DP_ARITHMETIC_WIDTH, __VA_ARGS__)
+#define DEFINE_DP_ARITHMETIC_OP(...) DP_SETS_FLAGS(DEFINE_DP_ARITHMETIC_FLAGS, __VA_ARGS__)
+DP_ARITHMETIC_OPS(DEFINE_DP_ARITHMETIC_OP)
+
+#define DP_ARITHMETIC_ENTRY(name, opc, flags_name, sets_flags, width, sf, shift_name, shift) \
+    [shift] = dp_reg_##name##_##flags_name##_##width##_##shift_name,
+#define DP_ARITHMETIC_WIDTH_ROW(name, opc, flags_name, sets_flags, width, sf) \
+    [sf] = { DP_SHIFTS(DP_ARITHMETIC_ENTRY, name, opc, flags_name, sets_flags, width, sf) },
+#define DP_ARITHMETIC_FLAGS_ROW(name, opc, flags_name, sets_flags) \
+    [sets_flags] = { DP_WIDTHS(DP_ARITHMETIC_WIDTH_ROW, name, opc, flags_name, sets_flags) },
+#define DP_ARITHMETIC_ROW(name, opc) [opc] = { DP_SETS_FLAGS(DP_ARITHMETIC_FLAGS_ROW, name, opc) },
+static const InstructionHandler dp_arithmetic_handlers[4][2][2][4] = {
+    DP_ARITHMETIC_OPS(DP_ARITHMETIC_ROW)
+};
+
+// Multiply: name, x
+#define DP_MULTIPLY_OPS(X) \
+    X(madd, 0) \
+    X(msub, 1)
+
+#define DEFINE_DP_MULTIPLY(name, x, width, sf) \
+    static bool dp_reg_##name##_##width(ARMState* state, const DecodedInstruction* instr) { \
+        dp_reg_multiply(state, instr, x, sf); \
+        return false; \
+    }
+#define DEFINE_DP_MULTIPLY_OP(...) DP_WIDTHS(DEFINE_DP_MULTIPLY, __VA_ARGS__)
+DP_MULTIPLY_OPS(DEFINE_DP_MULTIPLY_OP)
+
+#define DP_MULTIPLY_ENTRY(name, x, width, sf) [sf] = dp_reg_##name##_##width,
+#define DP_MULTIPLY_ROW(name, x) [x] = { DP_WIDTHS(DP_MULTIPLY_ENTRY, name, x) },
+static const InstructionHandler dp_multiply_handlers[2][2] = {
+    DP_MULTIPLY_OPS(DP_MULTIPLY_ROW)
+};
+
+InstructionHandler resolve_dp_handler(const DecodedInstruction* instr) {
+    bool sf = instr->sf;
+    if (instr->type == DP_IMM) {
+        switch (instr->dp_imm.opi) {
+            case 0x2: return dp_imm_arithmetic_handlers[instr->dp_imm.opc & 0x3][sf];
+            case 0x5: return dp_wide_move_handlers[instr->dp_imm.opc & 0x3][sf]; // NULL for opc 01
+            default: return NULL;
+        }
+    }
+
+    const DPRegFields* reg = &instr->dp_reg;
+    if (reg->M) {
+        return dp_multiply_handlers[reg->x & 0x1][sf];
+    }
+    // Logical operations also set flags when rd is ZR (TST), arithmetic ones N and Z (CMP without S)
+    bool sets_flags = reg->rd == 31 || ((reg->opr >> 3) ? (reg->opc & 0x1) : reg->opc == 0x3);
+    if (reg->opr >> 3) {
+        return dp_arithmetic_handlers[reg->opc & 0x3][sets_flags][sf][reg->shift_type & 0x3];
+    }
+    return dp_logical_handlers[(reg->opc & 0x3) * 2 + (reg->N & 0x1)][sets_flags][sf][reg->shift_type & 0x3];
+}
@@ -0,0 +1,17 @@
+#ifndef DP_HANDLERS_H
+#define DP_HANDLERS_H
+
+#include "arm_state.h"
+#include "instruction_types.h"
+#include "dispatch.h"
+
+// Specialized data processing handlers for threaded dispatch.
+// One handler is generated per (operation, sf, shift type, sets flags) combination,
+// so the fields the generic executors in dp_executor.c test on every execution are
+// resolved once, when the instruction is decoded.
+
+// Selects the specialized handler for a DP_IMM or DP_REG instruction, or NULL if
+// the generic executor must run it (wide move with the unallocated opc 01)
+InstructionHandler resolve_dp_handler(const DecodedInstruction* instr);
+
+#endif
@@ -1,137 +1,207 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
-#include <inttypes.h>
 #include <stdbool.h>
+#include <inttypes.h>
+#include <unistd.h>
 #include "arm_state.h"
-#include "decoder.h"
-#include "executor.h"
+#include "decode_cache.h"
+#include "decode_cache_file.h"
+#include "device_bus.h"
+#include "gpio.h"
+#include "watchpoint.h"
+#include "content_hash.h"
+#include "block_engine.h"
+#include "state_io.h"
 #include "constants.h"
+#ifdef JIT_ENABLED
+#include "jit.h"
+#endif
+#ifdef CACHE_SIM_ENABLED
+#include "cache_sim.h"
+#endif
+
+// Parses a memory size such as 4096, 64K, 256M or 1G; the result is rounded up to
+// whole pages. Returns false if text is not a size from one page to MAX_MEMORY_SIZE.
+static bool parse_memory_size(const char* text, uint64_t* size) {
+    char* end;
+    uint64_t value = strtoull(text, &end, 0);
+    unsigned shift = 0;
+    switch (*end) {
+        case 'K': case 'k': shift = 10; end++; break;
+        case 'M': case 'm': shift = 20; end++; break;
+        case 'G': case 'g': shift = 30; end++; break;
+        default: break;
+    }
+    if (end == text || *end != '\0' || text[0] == '-' || value == 0 || value > (MAX_MEMORY_SIZE >> shift)) {
+        return false;
+    }
+    value <<= shift;
+    *size = (value + MEMORY_PAGE_SIZE - 1) & ~(uint64_t)(MEMORY_PAGE_SIZE - 1);
+    return true;
+}
 
-void load_binary_to_memory(const char* filename, ARMState* state);
-void print_final_state(ARMState* state, FILE* output_file);
+// Parses a watchpoint such as 0x1000 or 0x1000,64 (address, then length in bytes;
+// 4 by default) and adds it. Returns false if text is not one.
+static bool parse_watchpoint(const char* text) {
+    char* end;
+    uint64_t address = strtoull(text, &end, 0);
+    uint64_t length = 4;
+    if (end == text || text[0] == '-') return false;
+    if (*end == ',') {
+        const char* length_text = end + 1;
+        length = strtoull(length_text, &end, 0);
+        if (end == length_text || length_text[0] == '-') return false;
+    }
+    return *end == '\0' && watchpoints_add(address, length);
+}
 
 int main(int argc, char **argv) {
-    if (argc < 2 || argc > 3) {
-        fprintf(stderr, "Usage: %s <file_in> [file_out]\n", argv[0]);
+    const char* cache_path = NULL;
+    bool snapshot = false;
+    const char* cache_config = NULL;
+    uint64_t memory_size = MEMORY_SIZE;
+    int option;
+    while ((option = getopt(argc, argv, "c:m:sw:C:")) != -1) {
+        if (option == 'c') {
+            cache_path = optarg;
+        } else if (option == 's') {
+            snapshot = true;
+        } else if (option == 'C') {
+            cache_config = optarg;
+        } else if (option == 'w') {
+            if (!parse_watchpoint(optarg)) {
+                fprintf(stderr, "Error: Invalid watchpoint '%s' (address[,length], at most %d)\n", optarg, MAX_WATCHPOINTS);
+                return EXIT_FAILURE;
+            }
+        } else if (option == 'm') {
+            if (!parse_memory_size(optarg, &memory_size)) {
+                fprintf(stderr, "Error: Invalid memory size '%s' (at most %dM)\n", optarg, MAX_MEMORY_SIZE >> 20);
+                return EXIT_FAILURE;
+            }
+        } else {
+            argc = 0; // Falls through to the usage message
+            break;
+        }
+    }
+    if (argc - optind < 1 || argc - optind > 2) {
+        fprintf(stderr, "Usage: %s [-c cache_file] [-m memory_size] [-s] [-w address[,length]] [-C cache_config] <file_in> [file_out]\n", argv[0]);
         return EXIT_FAILURE;
     }
+    const char* input_path = argv[optind];
+    const char* output_path = argc - optind == 2 ? argv[optind + 1] : NULL;
+
+#ifdef CACHE_SIM_ENABLED
+    CacheConfig cache_sim_config;
+    if (cache_config && !cache_config_parse(&cache_sim_config, cache_config)) {
+        fprintf(stderr, "Error: Invalid cache configuration '%s'\n", cache_config);
+        return EXIT_FAILURE;
+    }
+#else
+    if (cache_config) {
+        fprintf(stderr, "Error: Cache simulation needs an emulator built with `make CACHE_SIM=1`\n");
+        return EXIT_FAILURE;
+    }
+#endif
 
     ARMState arm_state;
-    initialize_arm_state(&arm_state);
-    load_binary_to_memory(argv[1], &arm_state);
+    if (!initialize_arm_state(&arm_state, memory_size)) {
+        return EXIT_FAILURE;
+    }
+    size_t bytes_loaded = load_binary_to_memory(input_path, &arm_state);
+
+    // Peripherals sit at fixed guest addresses, above RAM unless -m makes it larger
+    DeviceBus devices;
+    Gpio gpio;
+    device_bus_init(&devices);
+    gpio_attach(&gpio, &devices);
+    attach_device_bus(&arm_state, &devices);
 
     FILE* output_file = stdout;
-    if (argc == 3) {
-        output_file = fopen(argv[2], "w");
+    if (output_path) {
+        output_file = fopen(output_path, "w");
         if (!output_file) {
-            fprintf(stderr, "Error: Could not open output file '%s'\n", argv[2]);
+            fprintf(stderr, "Error: Could not open output file '%s'\n", output_path);
             return EXIT_FAILURE;
         }
     }
 
-    fprintf(stderr, "Starting emulation...\n");
-    
-    // Flag to control the main emulation loop
-    bool running = true;
-    // Store the PC value from the start of the current instruction's execution.
-    // Used to detect if the PC advanced after an instruction.
-    uint64_t prev_pc = arm_state.pc; 
-    
-    while (running && arm_state.pc < MEMORY_SIZE) { // Continue as long as 'running' is true and PC is within memory bounds
-        // Check if the Program Counter is 4-byte aligned
-        if (arm_state.pc % 4 != 0) { 
-             fprintf(stderr, "Error: PC (0x%016"PRIx64") is not 4-byte aligned. Terminating.\n", arm_state.pc);
-             running = false;
-             break; // Exit loop immediately for critical error
-        }
-
-        // Fetch the 32-bit instruction word from memory at the current PC
-        uint32_t instruction_word = read_word_from_memory(&arm_state, arm_state.pc);
-        // Decode the instruction word into its structured representation
-        DecodedInstruction decoded_instr = decode_instruction(instruction_word);
-        
-        // It returns false if the PC should simply be incremented by 4 by the main loop.
-        bool pc_was_modified_by_instruction = execute_instruction(&arm_state, &decoded_instr);
-
-        // After executing the instruction, check if it was the HALT instruction.
-        // We now set the 'running' flag to false to exit the emulation loop.
-        if (decoded_instr.type == HALT) {
-            running = false; 
-        } 
-        // If the instruction did not modify the PC (and it's not HALT), increment PC by 4 to the next instruction.
-        else if (!pc_was_modified_by_instruction) {
-            arm_state.pc += 4;
+    // Instructions are decoded once per address and reused until their page is written
+    DecodeCache* decode_cache = decode_cache_create(arm_state.memory_size);
+    if (!decode_cache) {
+        return EXIT_FAILURE;
+    }
+    arm_state.decode_cache = decode_cache;
+#ifdef CACHE_SIM_ENABLED
+    if (cache_config) {
+        arm_state.cache_sim = cache_sim_create(&cache_sim_config, arm_state.memory_size);
+        if (!arm_state.cache_sim) {
+            fprintf(stderr, "Error: Could not allocate the cache model\n");
+            return EXIT_FAILURE;
         }
-
-        // Detect if the Program Counter has not advanced since the beginning of this instruction's execution.
-        // This catches infinite loops like 'b .' (branch to self) where the PC might get stuck.
-        // This check is only performed if the emulator is still considered 'running' after the instruction.
-        if (running && arm_state.pc == prev_pc) { 
-            fprintf(stderr, "Warning: PC did not advance (0x%016"PRIx64"). Possible infinite loop. Terminating.\n", arm_state.pc);
-            running = false; // Set flag to stop execution
+    }
+#endif
+#ifdef JIT_ENABLED
+    // Translated blocks only write the PC back on exit, and watchpoint hits report it.
+    // They do not feed the cache model either.
+    if (watchpoints_active() || cache_config) {
+        jit_free(decode_cache->jit);
+        decode_cache->jit = NULL;
+    }
+#endif
+
+    // A cache file from an earlier run on the same image skips the decode warm-up
+    uint64_t image_hash = 0;
+    size_t cache_hits = 0;
+    if (cache_path) {
+        image_hash = content_hash(arm_state.memory, bytes_loaded);
+        bool stale = false;
+        cache_hits = decode_cache_load_file(decode_cache, &arm_state, cache_path, image_hash, &stale);
+        if (stale) {
+            fprintf(stderr, "Decode cache file '%s' does not match this image; rebuilding it.\n", cache_path);
         }
-        
-        // Update prev_pc for the next iteration.
-        prev_pc = arm_state.pc;
     }
-    fprintf(stderr, "Emulation finished.\n");
-
-    print_final_state(&arm_state, output_file);
 
-    if (output_file != stdout) {
-        fclose(output_file);
+    if (!watchpoints_arm(&arm_state)) {
+        return EXIT_FAILURE;
     }
 
-    return EXIT_SUCCESS;
-}
-
-void load_binary_to_memory(const char* filename, ARMState* state) {
-    FILE* file = fopen(filename, "rb"); 
-    if (!file) {
-        fprintf(stderr, "Error: Could not open input file '%s'\n", filename);
-        exit(EXIT_FAILURE);
+    fprintf(stderr, "Starting emulation...\n");
+    // Execution proceeds one basic block at a time until HALT or an error
+    run_blocks(&arm_state, decode_cache);
+    fprintf(stderr, "Emulation finished.\n");
+    watchpoints_disarm(&arm_state);
+
+    if (cache_path) {
+        fprintf(stderr, "Decode cache file '%s': %zu hits, %" PRIu64 " misses\n", cache_path, cache_hits,
+                decode_cache->decodes);
+        // Only rewrite the file when the run decoded something it did not hold
+        if (decode_cache->decodes > 0) {
+            decode_cache_save_file(decode_cache, &arm_state, cache_path, image_hash);
+        }
     }
 
-    // Read the entire file into memory
-    size_t element_size = 1; // Size of each element (1 byte)
-    size_t max_elements_to_read = sizeof(state->memory); // Max total bytes to read
+    // -s: a binary snapshot for snapdiff instead of the text dump
+    if (snapshot) {
+        write_snapshot(&arm_state, output_file);
+    } else {
+        print_final_state(&arm_state, output_file);
+    }
 
-    size_t elements_read = fread(state->memory, element_size, max_elements_to_read, file);
-    size_t bytes_read_total = elements_read * element_size; // Calculate total bytes read
+#ifdef CACHE_SIM_ENABLED
+    if (arm_state.cache_sim) {
+        cache_sim_report(arm_state.cache_sim, stderr);
+        cache_sim_free(arm_state.cache_sim);
+        arm_state.cache_sim = NULL;
+    }
+#endif
 
+    arm_state.decode_cache = NULL;
+    decode_cache_free(decode_cache);
+    free_arm_state(&arm_state);
 
-    if (elements_read == 0 && !feof(file)) { // Check if it's an actual read error, not just empty file
-        fprintf(stderr, "Error: Could not read from input file '%s'\n", filename);
-        fclose(file);
-        exit(EXIT_FAILURE);
-    }
-    if (bytes_read_total > sizeof(state->memory)) {
-        fprintf(stderr, "Warning: Input file '%s' is larger than 2MB memory capacity. Only first 2MB loaded.\n", filename);
+    if (output_file != stdout) {
+        fclose(output_file);
     }
 
-    fclose(file);
-    fprintf(stderr, "Loaded %zu bytes from '%s' into memory.\n", bytes_read_total, filename);
+    return EXIT_SUCCESS;
 }
-
-void print_final_state(ARMState* state, FILE* output_file) {
-    fprintf(output_file, "Registers:\n");
-    for (int i = 0; i < 31; ++i) {
-        fprintf(output_file, "X%02d = %016"PRIx64"\n", i, state->registers[i]);
-    }
-    fprintf(output_file, "PC = %016"PRIx64"\n", state->pc);
-    fprintf(output_file, "PSTATE : %c%c%c%c\n",
-            state->pstate.N ? 'N' : '-',
-            state->pstate.Z ? 'Z' : '-',
-            state->pstate.C ? 'C' : '-',
-            state->pstate.V ? 'V' : '-');
-
-    fprintf(output_file, "Non-zero memory:\n");
-    for (uint32_t addr = 0; addr < sizeof(state->memory); addr += 4) {
-        // Read a 32-bit word, then check if it's non-zero
-        uint32_t word = read_word_from_memory(state, addr);
-        if (word != 0) {
-            fprintf(output_file, "0x%08x: %08x\n", addr, word);
-        }
-    }
-}
\ No newline at end of file
@@ -6,12 +6,42 @@
 #include "decoder.h"
 
 
+// NZCV values (as bit positions) with Z set, and with N == V
+#define WHEN_Z      0xF0F0
+#define WHEN_N_EQ_V 0xAA55
+
+const uint16_t condition_table[16] = {
+    [0x0] = WHEN_Z,                                 // EQ
+    [0x1] = (uint16_t)~WHEN_Z,                      // NE
+    [0xA] = WHEN_N_EQ_V,                            // GE
+    [0xB] = (uint16_t)~WHEN_N_EQ_V,                 // LT
+    [0xC] = WHEN_N_EQ_V & (uint16_t)~WHEN_Z,        // GT
+    [0xD] = (uint16_t)~(WHEN_N_EQ_V & ~WHEN_Z),     // LE
+    [0xE] = 0xFFFF,                                 // AL (always)
+};
+
+// Evaluates a b.cond condition code against PSTATE
+bool condition_holds(ARMState* state, uint8_t cond) {
+    // EQ and NE (the common loop case) do not need the other flags computed
+    if (cond == 0x0 || cond == 0x1) {
+        return zero_flag(state) == (cond == 0x0);
+    }
+    materialize_flags(state);
+    if (flags_satisfy(state->nzcv, cond)) {
+        return true;
+    }
+    if (condition_table[cond & 0xF] == 0) {
+        fprintf(stderr, "Error: Invalid conditional branch condition 0x%x\n", cond);
+    }
+    return false;
+}
+
 // Returns true if the PC was modified by the instruction (e.g., a taken branch)
 // and false otherwise (meaning the main loop should increment PC by 4)
-bool execute_instruction(ARMState* state, DecodedInstruction* instr) {
+bool execute_instruction(ARMState* state, const DecodedInstruction* instr) {
     #ifdef DEBUG
     fprintf(stderr, "Executing instruction type %d at PC 0x%016"PRIx64" (raw: 0x%08x)\n",
-            instr->type, state->pc, instr->raw_instruction);
+            instr->type, state->pc, read_word_from_memory(state, (uint32_t)state->pc));
     #endif
 
     switch (instr->type) {
@@ -25,17 +55,10 @@ bool execute_instruction(ARMState* state, DecodedInstruction* instr) {
             return false; // PC will be incremented by 4 in main loop
 
         case SDT: {
-            // Determine addressing mode for SDT
-            addressing_mode mode;
-            if (instr->sdt_U) { // Unsigned offset
-                mode = UNSIGNED_IMMEDIATE;
-            } else if (get_bits(instr->raw_instruction, 21, 21)) { // Register offset
-                mode = REGISTER_OFFSET;
-            } else { // Pre/Post-indexing
-                mode = instr->sdt_I ? PRE_INDEXED : POST_INDEXED;
-            }
+            // The addressing mode was resolved by the decoder
+            addressing_mode mode = (addressing_mode)instr->sdt.mode;
 
-            if (instr->sdt_L) { // Load
+            if (instr->sdt.L) { // Load
                 execute_ldr(state, mode, instr);
             } else { // Store
                 execute_str(state, mode, instr);
@@ -49,37 +72,25 @@ bool execute_instruction(ARMState* state, DecodedInstruction* instr) {
 
         case BRANCH: {
             bool is_branch_taken = false;
-            // Compare the two most significant bits (instruction[31:30]) to determine the branch type
-            uint32_t branch_group_id = get_bits(instr->raw_instruction, 30, 31); 
+            // The two most significant bits (instruction[31:30]) determine the branch type
+            uint32_t branch_group_id = instr->branch.group; 
 
             switch (branch_group_id) {
                 case 0: {  // Unconditional branch with simm26 offset (pattern 000101 in bits 31-25)
-                    execute_branch_unconditional(state, instr->b_simm26);
+                    execute_branch_unconditional(state, instr->branch.offset);
                     is_branch_taken = true;
                     break;
                 }
                 case 3: {  // Register branch (pattern 11010110000 in bits 31-21)
-                    execute_branch_register(state, instr->b_xn);
+                    execute_branch_register(state, instr->branch.xn);
                     is_branch_taken = true;
                     break;
                 }
                 case 1: {  // Conditional branch (pattern 0101010 in bits 31-25)
                     // Evaluate the condition
-                    bool condition_met = false;
-                    switch (instr->b_cond) {
-                        case 0x0: condition_met = state->pstate.Z; break; // EQ
-                        case 0x1: condition_met = !state->pstate.Z; break; // NE
-                        case 0xA: condition_met = (state->pstate.N == state->pstate.V); break; // GE
-                        case 0xB: condition_met = (state->pstate.N != state->pstate.V); break; // LT
-                        case 0xC: condition_met = (state->pstate.Z == false && state->pstate.N == state->pstate.V); break; // GT
-                        case 0xD: condition_met = !(state->pstate.Z == false && state->pstate.N == state->pstate.V); break; // LE
-                        case 0xE: condition_met = true; break; // AL (always)
-                        default:
-                            fprintf(stderr, "Error: Invalid conditional branch condition 0x%x\n", instr->b_cond);
-                            break;
-                    }
+                    bool condition_met = condition_holds(state, instr->branch.cond);
                     if (condition_met) {
-                        execute_branch_unconditional(state, instr->b_simm19);
+                        execute_branch_unconditional(state, instr->branch.offset);
                         is_branch_taken = true;
                     } else {
                         is_branch_taken = false; // Branch not taken, PC will increment by 4
@@ -87,7 +98,7 @@ bool execute_instruction(ARMState* state, DecodedInstruction* instr) {
                     break;
                 }
                 default: {
-                    fprintf(stderr, "Error: Invalid branch instruction format for group id %u (raw: 0x%08x)\n", branch_group_id, instr->raw_instruction);
+                    fprintf(stderr, "Error: Invalid branch instruction format for group id %u at PC 0x%016" PRIx64 "\n", branch_group_id, state->pc);
                     // This would likely be a fatal error or unrecognized instruction
                     break; 
                 }
@@ -5,6 +5,19 @@
 #include "arm_state.h"
 #include "instruction_types.h"
 
-bool execute_instruction(ARMState* state, DecodedInstruction* instr);
+bool execute_instruction(ARMState* state, const DecodedInstruction* instr);
+
+// Condition lookup table shared by every conditional path: bit n of
+// condition_table[cond] is set if cond holds when the NZCV flags are n. Codes the
+// emulator does not implement (anything but EQ, NE, GE, LT, GT, LE and AL) have
+// no bits set, so they are never taken.
+extern const uint16_t condition_table[16];
+
+static inline bool flags_satisfy(uint8_t nzcv, uint8_t cond) {
+    return (condition_table[cond & 0xF] >> nzcv) & 1;
+}
+
+// Evaluates cond on the current flags, reporting unimplemented codes
+bool condition_holds(ARMState* state, uint8_t cond);
 
 #endif
\ No newline at end of file
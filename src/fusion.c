@@ -0,0 +1,138 @@
+#include <stddef.h>
+#include "fusion.h"
+#include "dp_bodies.h"
+#include "executor.h"
+#include "mem_branch_executor.h"
+
+// Longest movz/movk chain fused (a 64-bit constant takes four moves)
+#define MAX_CONSTANT_LENGTH 4
+
+// Handlers receive &entry->instr; the rest of the group follows entry in its page
+static inline const CachedInstruction* group_of(const DecodedInstruction* instr) {
+    return (const CachedInstruction*)((const char*)instr - offsetof(CachedInstruction, instr));
+}
+
+// --- Handlers ---
+
+// Second half of a compare + branch group, with state->pc still at the compare
+static inline bool branch_on_flags(ARMState* state, const DecodedInstruction* branch) {
+    state->pc += 4;
+    uint8_t cond = branch->branch.cond;
+    // EQ and NE test the result just recorded, as condition_holds would
+    bool taken = cond <= 0x1 ? zero_flag(state) == (cond == 0x0) : condition_holds(state, cond);
+    if (!taken) return false;
+    execute_branch_unconditional(state, branch->branch.offset);
+    return true;
+}
+
+// adds/subs + b.cond, instantiated per operation and width like the handlers in
+// dp_handlers.c; register compares are specialized for LSL, the usual cmp form
+#define FUSED_COMPARE_BRANCH(name, body) \
+    static bool name(ARMState* state, const DecodedInstruction* instr) { \
+        body; \
+        return branch_on_flags(state, &group_of(instr)[1].instr); \
+    }
+
+FUSED_COMPARE_BRANCH(fused_adds_imm32_branch, dp_imm_arithmetic(state, instr, false, FLAGS_ADDS, false))
+FUSED_COMPARE_BRANCH(fused_adds_imm64_branch, dp_imm_arithmetic(state, instr, false, FLAGS_ADDS, true))
+FUSED_COMPARE_BRANCH(fused_subs_imm32_branch, dp_imm_arithmetic(state, instr, true, FLAGS_SUBS, false))
+FUSED_COMPARE_BRANCH(fused_subs_imm64_branch, dp_imm_arithmetic(state, instr, true, FLAGS_SUBS, true))
+FUSED_COMPARE_BRANCH(fused_adds_reg32_branch, dp_reg_arithmetic(state, instr, 0x1, true, SHIFT_LSL, false))
+FUSED_COMPARE_BRANCH(fused_adds_reg64_branch, dp_reg_arithmetic(state, instr, 0x1, true, SHIFT_LSL, true))
+FUSED_COMPARE_BRANCH(fused_subs_reg32_branch, dp_reg_arithmetic(state, instr, 0x3, true, SHIFT_LSL, false))
+FUSED_COMPARE_BRANCH(fused_subs_reg64_branch, dp_reg_arithmetic(state, instr, 0x3, true, SHIFT_LSL, true))
+FUSED_COMPARE_BRANCH(fused_reg_compare_branch, execute_dp_reg_arithmetic(state, instr))
+
+// [subtract][sf]
+static const InstructionHandler imm_compare_branch_handlers[2][2] = {
+    { fused_adds_imm32_branch, fused_adds_imm64_branch },
+    { fused_subs_imm32_branch, fused_subs_imm64_branch },
+};
+static const InstructionHandler reg_compare_branch_handlers[2][2] = {
+    { fused_adds_reg32_branch, fused_adds_reg64_branch },
+    { fused_subs_reg32_branch, fused_subs_reg64_branch },
+};
+
+// movz/movn + movk...: builds the constant and writes the register once
+static bool fused_constant(ARMState* state, const DecodedInstruction* instr) {
+    const CachedInstruction* group = group_of(instr);
+    uint32_t length = group->fused_length;
+    bool sf = instr->sf;
+    uint8_t hw_shift = instr->dp_imm.hw * 16;
+    uint64_t value = (uint64_t)instr->dp_imm.imm << hw_shift;
+    if (instr->dp_imm.opc == 0x0) { // MOVN
+        value = ~value;
+    }
+    value = sf ? value : (uint32_t)value;
+
+    for (uint32_t i = 1; i < length; i++) {
+        const DecodedInstruction* movk = &group[i].instr;
+        hw_shift = movk->dp_imm.hw * 16;
+        uint64_t mask = (sf ? 0xFFFFULL : 0xFFFFU) << hw_shift;
+        value = (value & ~mask) | ((uint64_t)movk->dp_imm.imm << hw_shift);
+        value = sf ? value : (uint32_t)value;
+    }
+    state->registers[instr->dp_imm.rd] = value;
+    state->pc += 4 * (length - 1);
+    return false;
+}
+
+// --- Recognition ---
+
+static bool is_flag_setting_add_sub(const DecodedInstruction* instr) {
+    if (instr->type == DP_IMM) {
+        return instr->dp_imm.opi == 0x2 && (instr->dp_imm.opc & 0x1);
+    }
+    // Arithmetic (M = 0, opr[3] = 1) with S set
+    return instr->type == DP_REG && !instr->dp_reg.M && (instr->dp_reg.opr >> 3) && (instr->dp_reg.opc & 0x1);
+}
+
+static bool is_conditional_branch(const DecodedInstruction* instr) {
+    return instr->type == BRANCH && instr->branch.group == 1;
+}
+
+static bool is_wide_move(const DecodedInstruction* instr, uint8_t opc) {
+    return instr->type == DP_IMM && instr->dp_imm.opi == 0x5 && instr->dp_imm.opc == opc;
+}
+
+// movk continuing the chain started by head
+static bool continues_constant(const DecodedInstruction* head, const DecodedInstruction* instr) {
+    return is_wide_move(instr, 0x3) && instr->sf == head->sf && instr->dp_imm.rd == head->dp_imm.rd;
+}
+
+// Returns the length of the sequence starting at entry (1 if none) and its handler
+static uint32_t match_group(const CachedInstruction* entry, uint32_t available, InstructionHandler* handler) {
+    const DecodedInstruction* head = &entry->instr;
+
+    if (available >= 2 && is_flag_setting_add_sub(head) && is_conditional_branch(&entry[1].instr)) {
+        if (head->type == DP_IMM) {
+            *handler = imm_compare_branch_handlers[head->dp_imm.opc >> 1][head->sf];
+        } else if (head->dp_reg.shift_type == SHIFT_LSL) {
+            *handler = reg_compare_branch_handlers[head->dp_reg.opc >> 1][head->sf];
+        } else {
+            *handler = fused_reg_compare_branch;
+        }
+        return 2;
+    }
+
+    if ((is_wide_move(head, 0x2) || is_wide_move(head, 0x0)) && head->dp_imm.rd != 31) {
+        uint32_t length = 1;
+        while (length < available && length < MAX_CONSTANT_LENGTH && continues_constant(head, &entry[length].instr)) {
+            length++;
+        }
+        *handler = fused_constant;
+        return length;
+    }
+    return 1;
+}
+
+void fuse_block(CachedInstruction* entry, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        InstructionHandler handler;
+        uint32_t group = match_group(&entry[i], length - i, &handler);
+        if (group > 1) {
+            entry[i].fused_length = (uint8_t)group;
+            entry[i].handler = handler;
+        }
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include <stdint.h>
+#include "decode_cache.h"
+
+// Macro-op fusion.
+// Common instruction sequences inside a block are run by one handler, bound to the
+// first slot of the sequence, so the intermediate result passes between them
+// without a dispatch:
+//   compare + branch   adds/subs (immediate or register, including cmp/cmn)
+//                      followed by the block's b.cond
+//   constant           movz/movn Xd followed by movk Xd (same register and width)
+// The other slots keep their own decode and handler, so a branch that lands in
+// the middle of a sequence simply starts a block there and runs them one by one.
+//
+// A fused handler follows the InstructionHandler contract for the group as a
+// whole: unless it redirects the PC, it leaves state->pc at the group's last
+// instruction and returns false.
+
+// Fuses the sequences in the block of length instructions starting at entry,
+// setting fused_length and the handler of each slot that heads one
+void fuse_block(CachedInstruction* entry, uint32_t length);
+
+#endif
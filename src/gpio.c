@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "gpio.h"
+
+#define GPFSEL0 (GPIO_BASE + 0x00)
+#define GPFSEL2 (GPIO_BASE + 0x08)
+#define GPFSEL5 (GPIO_BASE + 0x14)
+#define GPSET0  (GPIO_BASE + 0x1C)
+#define GPCLR0  (GPIO_BASE + 0x28)
+
+#define LED_PIN 21
+
+// Function select registers read back what was written; the set and clear
+// registers are write-only and read as 0
+static uint64_t gpio_read(void* context, uint64_t address, unsigned width) {
+    const Gpio* gpio = context;
+    if (width != 4) {
+        fprintf(stderr, "Warning: 64-bit LDR from GPIO address 0x%08" PRIx64 " ignored.\n", address);
+        return 0;
+    }
+    if (address >= GPFSEL0 && address <= GPFSEL5 && address % 4 == 0) {
+        return gpio->function_select[(address - GPFSEL0) / 4];
+    }
+    return 0;
+}
+
+static void gpio_write(void* context, uint64_t address, unsigned width, uint64_t value) {
+    Gpio* gpio = context;
+    if (width != 4) {
+        fprintf(stderr, "Warning: 64-bit STR to GPIO address 0x%08" PRIx64 " ignored.\n", address);
+        return;
+    }
+    if (address >= GPFSEL0 && address <= GPFSEL5 && address % 4 == 0) {
+        gpio->function_select[(address - GPFSEL0) / 4] = (uint32_t)value;
+    }
+
+    switch (address) {
+        case GPFSEL2:
+            printf("One GPIO pin from 20 to 29 has been configured\n");
+            break;
+        case GPSET0:
+            // For turning the LED ON
+            if (value & (1U << LED_PIN)) {
+                printf("PIN ON\n");
+            }
+            break;
+        case GPCLR0:
+            // For turning the LED OFF
+            if (value & (1U << LED_PIN)) {
+                printf("PIN OFF\n");
+            }
+            break;
+    }
+}
+
+bool gpio_attach(Gpio* gpio, DeviceBus* bus) {
+    memset(gpio, 0, sizeof(*gpio));
+    return device_bus_add(bus, GPIO_BASE, GPIO_SIZE, gpio_read, gpio_write, gpio);
+}
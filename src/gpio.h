@@ -0,0 +1,21 @@
+#ifndef GPIO_H
+#define GPIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "device_bus.h"
+
+// Raspberry Pi 3 GPIO controller, as far as the LED programs use it: configuring a
+// pin from 20 to 29 (GPFSEL2) and switching pin 21 on (GPSET0) or off (GPCLR0) are
+// reported on stdout. The Pi only allows 32-bit accesses to it.
+#define GPIO_BASE 0x3f200000
+#define GPIO_SIZE 0x30 // GPFSEL0 up to GPCLR1
+
+typedef struct {
+    uint32_t function_select[6]; // GPFSEL0-5, as last written
+} Gpio;
+
+// Resets gpio and claims its registers on bus
+bool gpio_attach(Gpio* gpio, DeviceBus* bus);
+
+#endif
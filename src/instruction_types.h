@@ -13,60 +13,77 @@ typedef enum {
     UNKNOWN  // Unknown or unrecognized
 } InstructionType;
 
-typedef struct {
-    uint32_t raw_instruction;
-    InstructionType type;
-
-    // Common fields for all instruction types
-    uint8_t sf;  // Register size flag (0: 32b, 1: 64b)
-
-    // Common fields for Data Processing instructions
-    uint8_t dp_opc;  // Opcode
-    uint8_t dp_rn;   // First operand register (11111: SP)
-    uint8_t dp_rd;   // Destination register (11111: SP (or ZR when instr. sets flags))
+// Per-format operand fields. Only the member matching DecodedInstruction.type is
+// meaningful; the layout keeps a decoded instruction within 16 bytes so a cache
+// line holds four of them.
 
-    // DP_IMM specific
-    uint8_t dp_imm_opi;  // Operation interpretation
-    // Arithmetic (opi == 010)
-    uint8_t dp_imm_sh;      // Left-shift imm12 by 12 bits? (0: no, 1: yes)
-    uint16_t dp_imm_imm12;  // Immediate value (12 bits)
-    // Wide move (opi == 101)
-    uint8_t dp_imm_hw;      // Logical shift left by hw*16 bits
-    uint16_t dp_imm_imm16;  // Immediate value (16 bits)
+// DP_IMM
+typedef struct {
+    uint8_t opc;   // Opcode
+    uint8_t opi;   // Operation interpretation (010: arithmetic, 101: wide move)
+    uint8_t rd;    // Destination register (11111: SP (or ZR when instr. sets flags))
+    uint8_t rn;    // First operand register (arithmetic only)
+    uint8_t sh;    // Arithmetic: left-shift imm12 by 12 bits? (0: no, 1: yes)
+    uint8_t hw;    // Wide move: logical shift left by hw*16 bits
+    uint16_t imm;  // Arithmetic: imm12, wide move: imm16
+} DPImmFields;
 
-    // DP_REG specific
-    uint8_t dp_reg_M;    // Operation interpretation
-    uint8_t dp_reg_opr;  // Operation interpretation (decays into shift & N when M == 0)
-    uint8_t dp_reg_rm;   // Second operand register
+// DP_REG
+typedef struct {
+    uint8_t opc;  // Opcode
+    uint8_t M;    // Operation interpretation (0: arithmetic/logical, 1: multiply)
+    uint8_t opr;  // Operation interpretation (decays into shift & N when M == 0)
+    uint8_t rd;   // Destination register
+    uint8_t rn;   // First operand register
+    uint8_t rm;   // Second operand register
     // Arithmetic and Logical (M == 0)
-    uint8_t dp_reg_shift_type;    // Shift type (0: LSL, 1: LSR, 2: ASR, 3: ROR)
-    uint8_t dp_reg_N;             // Bitwise negate the shifted register? (0: no, 1: yes)
-    uint8_t dp_reg_shift_amount;  // Immediate value (6 bits, used for shift amount)
+    uint8_t shift_type;    // Shift type (0: LSL, 1: LSR, 2: ASR, 3: ROR)
+    uint8_t N;             // Bitwise negate the shifted register? (0: no, 1: yes)
+    uint8_t shift_amount;  // Immediate value (6 bits, used for shift amount)
     // Multiply (M == 1)
-    uint8_t dp_reg_x;   // Negate the product? (0: no, 1: yes)
-    uint8_t dp_reg_ra;  // Accumulator register (11111: ZR)
+    uint8_t x;   // Negate the product? (0: no, 1: yes)
+    uint8_t ra;  // Accumulator register (11111: ZR)
+} DPRegFields;
 
-    // Common fields for SDT and LL instructions
-    uint8_t sdt_ll_rt;  // Target register
+// SDT
+typedef struct {
+    uint8_t rt;     // Target register
+    uint8_t xn;     // Base register
+    uint8_t xm;     // Offset register (REGISTER_OFFSET)
+    uint8_t L;      // Transfer type (0: store, 1: load)
+    uint8_t mode;   // addressing_mode, resolved from U, I and bit 21 at decode time
+    int16_t simm9;  // Signed immediate offset (PRE_INDEXED/POST_INDEXED)
+    uint16_t imm12; // Immediate value for unsigned offset (UNSIGNED_IMMEDIATE)
+} SDTFields;
 
-    // SDT specific
-    uint8_t sdt_U;       // Unsigned offset flag (0: signed, 1: unsigned)
-    uint8_t sdt_L;       // Transfer type (0: store, 1: load)
-    uint8_t sdt_xn;      // Base register
-    uint8_t sdt_xm;      // Offset register
-    uint8_t sdt_I;       // Post/Pre-indexing (0: post-index, 1: pre-index)
-    int64_t sdt_simm9;   // Signed immediate offset (sign-extended to 64 bits)
-    uint16_t sdt_imm12;  // Immediate value for unsigned offset (U == 1)
+// LL
+typedef struct {
+    uint8_t rt;      // Target register
+    int32_t simm19;  // Literal offset (sign-extended)
+} LLFields;
 
-    // LL specific
-    int64_t ll_simm19;  // Literal offset (sign-extended to 64 bits)
+// BRANCH
+typedef struct {
+    uint8_t group;   // instruction[31:30] (0: unconditional, 1: conditional, 3: register)
+    uint8_t xn;      // Destination address register (11111: ZR)
+    uint8_t cond;    // Condition (conditional only)
+    int32_t offset;  // simm26 (unconditional) or simm19 (conditional), sign-extended
+} BranchFields;
 
-    // BRANCH specific
-    int64_t b_simm26;  // Signed immediate offset (sign-extended to 64 bits)
-    uint8_t b_xn;      // Destination address register (11111: ZR)
-    int64_t b_simm19;  // Signed immediate offset for conditional jump (sign-extended to 64 bits)
-    uint8_t b_cond;    // Condition
+typedef struct {
+    uint8_t type;  // InstructionType
+    uint8_t sf;    // Register size flag (0: 32b, 1: 64b)
 
+    union {
+        DPImmFields dp_imm;
+        DPRegFields dp_reg;
+        SDTFields sdt;
+        LLFields ll;
+        BranchFields branch;
+        uint32_t raw_instruction;  // HALT and UNKNOWN keep the word for diagnostics
+    };
 } DecodedInstruction;
 
+_Static_assert(sizeof(DecodedInstruction) <= 16, "DecodedInstruction must fit in 16 bytes");
+
 #endif
\ No newline at end of file
@@ -0,0 +1,807 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include "jit.h"
+#include "dp_executor.h"
+#include "executor.h"
+#include "shifts.h"
+
+#if !defined(__x86_64__)
+#error "The JIT backend only targets x86-64 hosts (build without JIT=1)"
+#endif
+
+#define JIT_CODE_SIZE (16 * 1024 * 1024) // 16MB of translated code
+#define JIT_MAX_PENDING 64                // Queued blocks before requests are turned down
+
+// A block handed to the compiler thread. The decoded instructions are copied, so
+// the worker never reads the decode cache, which the main thread keeps mutating.
+typedef struct JitJob {
+    struct JitJob* next;
+    DecodedPage* page;    // Where the block lives, to check it is unchanged on install
+    uint32_t slot;
+    uint32_t generation;  // Page generation the copy was taken in
+    uint64_t pc;
+    NativeBlock result;   // Set by the worker (NULL: not translatable)
+    uint32_t length;
+    DecodedInstruction instrs[];
+} JitJob;
+
+struct JitCompiler {
+    DecodeCache* cache;
+
+    // Owned by the worker once it runs
+    uint8_t* code; // RWX buffer, bump-allocated
+    size_t used;
+
+    // Requests, guarded by lock; the main thread only ever try-locks it
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    JitJob* pending_head;
+    JitJob* pending_tail;
+    uint32_t pending_count;
+    bool stopping;
+
+    // Started on the first request, so short runs never pay for a thread
+    pthread_t worker;
+    bool worker_started;
+    bool worker_failed;
+
+    // Finished jobs, pushed by the worker and taken all at once by the main thread
+    _Atomic(JitJob*) done;
+};
+
+// --- x86-64 registers ---
+enum {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+// Guest registers are cached in these callee-saved registers, so they survive
+// calls into C helpers. R15 holds the ARMState pointer.
+static const int guest_host_regs[] = { RBX, RBP, R12, R13, R14 };
+#define GUEST_HOST_REG_COUNT (sizeof(guest_host_regs) / sizeof(guest_host_regs[0]))
+
+// Condition codes for Jcc / SETcc
+enum { CC_B = 0x2, CC_E = 0x4, CC_NE = 0x5, CC_A = 0x7 };
+
+// ALU opcodes in "op r/m, reg" form, and the /digit of their imm32 form
+enum { ALU_ADD = 0x01, ALU_OR = 0x09, ALU_AND = 0x21, ALU_SUB = 0x29, ALU_XOR = 0x31, ALU_CMP = 0x39 };
+enum { IMM_ADD = 0, IMM_SUB = 5, IMM_CMP = 7 };
+// Shift group /digit
+enum { SHIFT_ROR_OP = 1, SHIFT_SHL_OP = 4, SHIFT_SHR_OP = 5, SHIFT_SAR_OP = 7 };
+
+#define STATE_REG(n) ((int32_t)(offsetof(ARMState, registers) + 8 * (n)))
+#define STATE_PC ((int32_t)offsetof(ARMState, pc))
+#define STATE_MEMORY ((int32_t)offsetof(ARMState, memory)) // The pointer, not the bytes
+#define STATE_RAM_END ((int32_t)offsetof(ARMState, ram_end))
+#define STATE_DIRTY_PAGES ((int32_t)offsetof(ARMState, dirty_pages))
+
+// Stores reuse the decode cache page number to mark the dirty page
+_Static_assert(DECODE_PAGE_SHIFT == MEMORY_PAGE_SHIFT, "decode cache pages must be memory pages");
+
+// Guest memory spans the cache's pages; at most MAX_MEMORY_SIZE, so bounds fit an imm32
+static uint64_t memory_size(const DecodeCache* cache) {
+    return cache->page_count << DECODE_PAGE_SHIFT;
+}
+
+typedef struct {
+    uint8_t* pos;
+    uint8_t* end;        // Writes past end are dropped and fail the translation
+    int host_of[31];     // Host register caching guest Xn, or -1
+    DecodeCache* cache;  // For the self-modifying code check on stores
+} Emitter;
+
+// --- Encoding ---
+static void emit8(Emitter* e, uint8_t byte) {
+    if (e->pos < e->end) *e->pos = byte;
+    e->pos++;
+}
+
+static void emit32(Emitter* e, uint32_t value) {
+    for (int i = 0; i < 4; i++) emit8(e, (uint8_t)(value >> (8 * i)));
+}
+
+static void emit64(Emitter* e, uint64_t value) {
+    for (int i = 0; i < 8; i++) emit8(e, (uint8_t)(value >> (8 * i)));
+}
+
+static void emit_rex(Emitter* e, bool w, int reg, int index, int base) {
+    uint8_t rex = 0x40 | (w << 3) | (((reg >> 3) & 1) << 2) | (((index >> 3) & 1) << 1) | ((base >> 3) & 1);
+    if (rex != 0x40) emit8(e, rex);
+}
+
+// Opcodes above 0xff are two-byte (0x0f-prefixed) opcodes
+static void emit_opcode(Emitter* e, uint32_t opcode) {
+    if (opcode > 0xff) emit8(e, (uint8_t)(opcode >> 8));
+    emit8(e, (uint8_t)opcode);
+}
+
+// op reg, r/m with a register operand
+static void emit_rr(Emitter* e, bool w, uint32_t opcode, int reg, int rm) {
+    emit_rex(e, w, reg, 0, rm);
+    emit_opcode(e, opcode);
+    emit8(e, 0xc0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// op reg, [base + index * scale + disp32] (index < 0: no index)
+static void emit_mem(Emitter* e, bool w, uint32_t opcode, int reg, int base, int index, int scale, int32_t disp) {
+    emit_rex(e, w, reg, index < 0 ? 0 : index, base);
+    emit_opcode(e, opcode);
+    if (index < 0 && (base & 7) != RSP) {
+        emit8(e, 0x80 | ((reg & 7) << 3) | (base & 7));
+    } else {
+        int scale_bits = scale == 8 ? 3 : scale == 4 ? 2 : scale == 2 ? 1 : 0;
+        emit8(e, 0x84 | ((reg & 7) << 3));
+        emit8(e, (uint8_t)((scale_bits << 6) | (((index < 0 ? RSP : index) & 7) << 3) | (base & 7)));
+    }
+    emit32(e, (uint32_t)disp);
+}
+
+static void emit_mov_rr(Emitter* e, bool w, int dst, int src) {
+    emit_rr(e, w, 0x89, src, dst);
+}
+
+static void emit_load(Emitter* e, bool w, int dst, int base, int index, int32_t disp) {
+    emit_mem(e, w, 0x8b, dst, base, index, 1, disp);
+}
+
+static void emit_store(Emitter* e, bool w, int base, int index, int32_t disp, int src) {
+    emit_mem(e, w, 0x89, src, base, index, 1, disp);
+}
+
+static void emit_mov_imm(Emitter* e, int dst, uint64_t imm) {
+    if (imm <= UINT32_MAX) {
+        emit_rex(e, false, 0, 0, dst);
+        emit8(e, 0xb8 + (dst & 7));
+        emit32(e, (uint32_t)imm);
+    } else {
+        emit_rex(e, true, 0, 0, dst);
+        emit8(e, 0xb8 + (dst & 7));
+        emit64(e, imm);
+    }
+}
+
+static void emit_alu(Emitter* e, bool w, uint8_t op, int dst, int src) {
+    emit_rr(e, w, op, src, dst);
+}
+
+static void emit_alu_imm(Emitter* e, bool w, int digit, int dst, int32_t imm) {
+    emit_rr(e, w, 0x81, digit, dst);
+    emit32(e, (uint32_t)imm);
+}
+
+static void emit_shift_imm(Emitter* e, bool w, int digit, int dst, uint8_t amount) {
+    emit_rr(e, w, 0xc1, digit, dst);
+    emit8(e, amount);
+}
+
+static void emit_prologue(Emitter* e) {
+    static const int saved[] = { RBX, RBP, R12, R13, R14, R15 };
+    for (size_t i = 0; i < 6; i++) {
+        emit_rex(e, false, 0, 0, saved[i]);
+        emit8(e, 0x50 + (saved[i] & 7));
+    }
+    emit8(e, 0x48); emit8(e, 0x83); emit8(e, 0xec); emit8(e, 0x08); // sub rsp, 8 (16-byte alignment)
+    emit_mov_rr(e, true, R15, RDI);
+}
+
+// Forward Jcc rel32; returns the offset field to patch
+static uint8_t* emit_jcc(Emitter* e, int cc) {
+    emit8(e, 0x0f);
+    emit8(e, 0x80 + cc);
+    uint8_t* field = e->pos;
+    emit32(e, 0);
+    return field;
+}
+
+static void patch_here(Emitter* e, uint8_t* field) {
+    if (e->pos > e->end) return;
+    int32_t rel = (int32_t)(e->pos - (field + 4));
+    for (int i = 0; i < 4; i++) field[i] = (uint8_t)((uint32_t)rel >> (8 * i));
+}
+
+// --- Guest state ---
+
+// Host <- guest Xn (ZR reads 0; 32-bit reads zero-extend)
+static void load_guest(Emitter* e, int host, uint8_t reg, bool sf) {
+    if (reg == 31) {
+        emit_alu(e, false, ALU_XOR, host, host);
+    } else if (e->host_of[reg] >= 0) {
+        emit_mov_rr(e, sf, host, e->host_of[reg]);
+    } else {
+        emit_load(e, sf, host, R15, -1, STATE_REG(reg));
+    }
+}
+
+// Guest Xn <- host (writes to ZR are ignored; 32-bit writes clear the upper half,
+// truncating the host register in place)
+static void store_guest(Emitter* e, uint8_t reg, int host, bool sf) {
+    if (reg == 31) return;
+    if (!sf) emit_mov_rr(e, false, host, host);
+    if (e->host_of[reg] >= 0) {
+        emit_mov_rr(e, true, e->host_of[reg], host);
+    } else {
+        emit_store(e, true, R15, -1, STATE_REG(reg), host);
+    }
+}
+
+// Writes the cached guest registers back, sets the PC (unless the caller stored it
+// already) and returns completed to the block engine
+static void emit_exit(Emitter* e, bool set_pc, uint64_t pc, bool completed) {
+    for (int reg = 0; reg < 31; reg++) {
+        if (e->host_of[reg] >= 0) emit_store(e, true, R15, -1, STATE_REG(reg), e->host_of[reg]);
+    }
+    if (set_pc) {
+        emit_mov_imm(e, RAX, pc);
+        emit_store(e, true, R15, -1, STATE_PC, RAX);
+    }
+    emit_mov_imm(e, RAX, completed);
+    emit8(e, 0x48); emit8(e, 0x83); emit8(e, 0xc4); emit8(e, 0x08); // add rsp, 8
+    static const int restored[] = { R15, R14, R13, R12, RBP, RBX };
+    for (size_t i = 0; i < 6; i++) {
+        emit_rex(e, false, 0, 0, restored[i]);
+        emit8(e, 0x58 + (restored[i] & 7));
+    }
+    emit8(e, 0xc3); // ret
+}
+
+// Leaves the block at pc (before the instruction there runs) if cc holds
+static void emit_side_exit_if(Emitter* e, int cc, uint64_t pc) {
+    uint8_t* skip = emit_jcc(e, cc ^ 1); // Inverted condition jumps over the exit
+    emit_exit(e, true, pc, false);
+    patch_here(e, skip);
+}
+
+#define STATE_FLAG_OP(field) ((int32_t)offsetof(ARMState, last_flag_op.field))
+#define STATE_NZCV ((int32_t)offsetof(ARMState, nzcv))
+
+// update_flags(state, result = RAX, op1 = RDX, op2 = RCX, kind, sf). The operation
+// is recorded inline; only FLAGS_NZ, which may have to materialize the previous
+// one first, calls out.
+static void emit_update_flags(Emitter* e, FlagUpdate kind, bool sf) {
+    if (kind != FLAGS_NZ) {
+        emit_store(e, true, R15, -1, STATE_FLAG_OP(result), RAX);
+        emit_store(e, true, R15, -1, STATE_FLAG_OP(op1), RDX);
+        emit_store(e, true, R15, -1, STATE_FLAG_OP(op2), RCX);
+        emit_mem(e, false, 0xc6, 0, R15, -1, 1, STATE_FLAG_OP(kind)); // mov byte [kind], imm8
+        emit8(e, (uint8_t)kind);
+        emit_mem(e, false, 0xc6, 0, R15, -1, 1, STATE_FLAG_OP(sf));
+        emit8(e, sf);
+        return;
+    }
+    emit_mov_rr(e, true, RSI, RAX);
+    emit_mov_rr(e, true, RDI, R15);
+    emit_mov_imm(e, R8, kind);
+    emit_mov_imm(e, R9, sf);
+    emit_mov_imm(e, RAX, (uint64_t)(uintptr_t)update_flags);
+    emit8(e, 0xff); emit8(e, 0xd0); // call rax
+}
+
+// --- Instructions ---
+
+static void emit_dp_imm_arithmetic(Emitter* e, const DecodedInstruction* instr) {
+    bool sf = instr->sf;
+    uint32_t imm = (uint32_t)instr->dp_imm.imm << (instr->dp_imm.sh ? 12 : 0);
+    bool is_subtract = instr->dp_imm.opc & 0x2;
+
+    load_guest(e, RDX, instr->dp_imm.rn, sf);
+    emit_mov_rr(e, true, RAX, RDX);
+    emit_alu_imm(e, true, is_subtract ? IMM_SUB : IMM_ADD, RAX, (int32_t)imm);
+
+    if (instr->dp_imm.opc & 0x1) {
+        // Flags see the untruncated result, so store a copy
+        emit_mov_rr(e, true, RSI, RAX);
+        store_guest(e, instr->dp_imm.rd, RSI, sf);
+        emit_mov_imm(e, RCX, imm);
+        emit_update_flags(e, is_subtract ? FLAGS_SUBS : FLAGS_ADDS, sf);
+    } else {
+        store_guest(e, instr->dp_imm.rd, RAX, sf);
+    }
+}
+
+static void emit_dp_imm_wide_move(Emitter* e, const DecodedInstruction* instr) {
+    bool sf = instr->sf;
+    uint8_t hw_shift = instr->dp_imm.hw * 16;
+    uint64_t operand_to_move = (uint64_t)instr->dp_imm.imm << hw_shift;
+
+    switch (instr->dp_imm.opc) {
+        case 0x00: // MOVN
+            emit_mov_imm(e, RAX, sf ? ~operand_to_move : (uint32_t)(~operand_to_move));
+            break;
+        case 0x02: // MOVZ
+            emit_mov_imm(e, RAX, operand_to_move);
+            break;
+        case 0x03: { // MOVK
+            uint64_t mask_16bit_at_pos = (sf ? 0xFFFFULL : 0xFFFFU) << hw_shift;
+            load_guest(e, RAX, instr->dp_imm.rd, sf);
+            emit_mov_imm(e, RCX, ~mask_16bit_at_pos);
+            emit_alu(e, true, ALU_AND, RAX, RCX);
+            emit_mov_imm(e, RCX, operand_to_move);
+            emit_alu(e, true, ALU_OR, RAX, RCX);
+            break;
+        }
+    }
+    store_guest(e, instr->dp_imm.rd, RAX, sf);
+}
+
+// Applies the operand shift of a DP_REG instruction to host register reg, matching
+// execute_shift (including 32-bit shifts by 32 or more)
+static void emit_operand_shift(Emitter* e, int reg, const DecodedInstruction* instr) {
+    bool sf = instr->sf;
+    uint8_t amount = instr->dp_reg.shift_amount;
+    ShiftType type = (ShiftType)instr->dp_reg.shift_type;
+
+    if (type == SHIFT_ROR) amount %= sf ? 64 : 32;
+    if (amount == 0) return;
+
+    if (!sf && amount >= 32) {
+        // Everything is shifted out of the 32-bit value
+        if (type == SHIFT_ASR) {
+            emit_shift_imm(e, false, SHIFT_SAR_OP, reg, 31);
+        } else {
+            emit_alu(e, false, ALU_XOR, reg, reg);
+        }
+        return;
+    }
+    static const int digits[] = { SHIFT_SHL_OP, SHIFT_SHR_OP, SHIFT_SAR_OP, SHIFT_ROR_OP };
+    emit_shift_imm(e, sf, digits[type], reg, amount);
+}
+
+static void emit_dp_reg_logical(Emitter* e, const DecodedInstruction* instr) {
+    bool sf = instr->sf;
+    static const uint8_t ops[] = { ALU_AND, ALU_OR, ALU_XOR, ALU_AND };
+
+    load_guest(e, RAX, instr->dp_reg.rn, sf);
+    load_guest(e, RCX, instr->dp_reg.rm, sf);
+    emit_operand_shift(e, RCX, instr);
+    if (instr->dp_reg.N) emit_rr(e, sf, 0xf7, 2, RCX); // not
+    emit_mov_rr(e, true, RDX, RAX);
+    emit_alu(e, true, ops[instr->dp_reg.opc], RAX, RCX);
+
+    store_guest(e, instr->dp_reg.rd, RAX, sf);
+    if (instr->dp_reg.opc == 3 || instr->dp_reg.rd == 31) {
+        emit_update_flags(e, FLAGS_LOGICAL, sf);
+    }
+}
+
+static void emit_dp_reg_arithmetic(Emitter* e, const DecodedInstruction* instr) {
+    bool sf = instr->sf;
+    uint8_t opc = instr->dp_reg.opc;
+
+    load_guest(e, RDX, instr->dp_reg.rn, sf);
+    load_guest(e, RCX, instr->dp_reg.rm, sf);
+    emit_operand_shift(e, RCX, instr);
+    emit_mov_rr(e, true, RAX, RDX);
+    emit_alu(e, true, (opc & 0x2) ? ALU_SUB : ALU_ADD, RAX, RCX);
+    if (!sf) emit_mov_rr(e, false, RAX, RAX);
+
+    store_guest(e, instr->dp_reg.rd, RAX, sf);
+    if ((opc & 0x1) || instr->dp_reg.rd == 31) {
+        emit_update_flags(e, opc == 0x1 ? FLAGS_ADDS : opc == 0x3 ? FLAGS_SUBS : FLAGS_NZ, sf);
+    }
+}
+
+static void emit_dp_reg_multiply(Emitter* e, const DecodedInstruction* instr) {
+    bool sf = instr->sf;
+
+    load_guest(e, RAX, instr->dp_reg.rn, sf);
+    load_guest(e, RCX, instr->dp_reg.rm, sf);
+    load_guest(e, RDX, instr->dp_reg.ra, sf);
+    emit_rr(e, sf, 0x0faf, RAX, RCX); // imul rax, rcx
+    emit_alu(e, true, instr->dp_reg.x ? ALU_SUB : ALU_ADD, RDX, RAX);
+    store_guest(e, instr->dp_reg.rd, RDX, sf);
+}
+
+static void emit_sdt(Emitter* e, const DecodedInstruction* instr, uint64_t pc) {
+    bool sf = instr->sf;
+    int width = sf ? 8 : 4;
+    int32_t simm9 = instr->sdt.simm9;
+
+    // Target address in RAX (and the base register in RDX for writeback)
+    switch ((addressing_mode)instr->sdt.mode) {
+        case UNSIGNED_IMMEDIATE:
+            load_guest(e, RAX, instr->sdt.xn, true);
+            emit_alu_imm(e, true, IMM_ADD, RAX, (int32_t)instr->sdt.imm12 << (sf ? 3 : 2));
+            break;
+        case PRE_INDEXED:
+        case POST_INDEXED:
+            load_guest(e, RDX, instr->sdt.xn, true);
+            emit_mov_rr(e, true, RAX, RDX);
+            if (instr->sdt.mode == PRE_INDEXED) emit_alu_imm(e, true, IMM_ADD, RAX, simm9);
+            break;
+        default: // REGISTER_OFFSET
+            load_guest(e, RAX, instr->sdt.xn, true);
+            load_guest(e, RCX, instr->sdt.xm, true);
+            emit_alu(e, true, ALU_ADD, RAX, RCX);
+            break;
+    }
+
+    // Only plain RAM is accessed inline; devices and faults go back to the interpreter.
+    // ram_end is read at run time, as devices can be attached after translation.
+    emit_load(e, true, RSI, R15, -1, STATE_RAM_END);
+    emit_alu_imm(e, true, IMM_SUB, RSI, (int32_t)width);
+    emit_alu(e, true, ALU_CMP, RAX, RSI);
+    emit_side_exit_if(e, CC_A, pc);
+    if (!instr->sdt.L) {
+        // Unaligned stores, and stores into a page with predecoded code, are left
+        // to execute_str so the decode cache sees them
+        emit8(e, 0xa9); emit32(e, (uint32_t)(width - 1)); // test eax, width - 1
+        emit_side_exit_if(e, CC_NE, pc);
+        emit_mov_rr(e, true, RCX, RAX);
+        emit_shift_imm(e, true, SHIFT_SHR_OP, RCX, DECODE_PAGE_SHIFT);
+        emit_mov_imm(e, RSI, (uint64_t)(uintptr_t)e->cache->pages);
+        emit_mem(e, true, 0x83, 7, RSI, RCX, 8, 0); // cmp qword [rsi + rcx * 8], imm8
+        emit8(e, 0);
+        emit_side_exit_if(e, CC_NE, pc);
+    }
+
+    if (instr->sdt.mode == PRE_INDEXED || instr->sdt.mode == POST_INDEXED) {
+        emit_alu_imm(e, true, IMM_ADD, RDX, simm9);
+        store_guest(e, instr->sdt.xn, RDX, true);
+    }
+
+    emit_load(e, true, RSI, R15, -1, STATE_MEMORY);
+    if (instr->sdt.L) {
+        emit_load(e, sf, RCX, RSI, RAX, 0);
+        store_guest(e, instr->sdt.rt, RCX, true);
+    } else {
+        // RCX still holds the page number: aligned stores never straddle two pages
+        emit_load(e, true, RDX, R15, -1, STATE_DIRTY_PAGES);
+        emit_mem(e, false, 0xc6, 0, RDX, RCX, 1, 0); // mov byte [rdx + rcx], 1
+        emit8(e, 1);
+        load_guest(e, RCX, instr->sdt.rt, true);
+        emit_store(e, sf, RSI, RAX, 0, RCX);
+    }
+}
+
+static void emit_load_literal(Emitter* e, const DecodedInstruction* instr, uint64_t pc) {
+    uint64_t address = pc + ((int64_t)instr->ll.simm19 << 2);
+    // A literal in RAM that a device shadows is read through the bus
+    emit_mem(e, true, 0x81, 7, R15, -1, 1, STATE_RAM_END); // cmp qword [ram_end], address + width
+    emit32(e, (uint32_t)(address + (instr->sf ? 8 : 4)));
+    emit_side_exit_if(e, CC_B, pc);
+    emit_load(e, true, RSI, R15, -1, STATE_MEMORY);
+    emit_load(e, instr->sf, RCX, RSI, -1, (int32_t)address);
+    store_guest(e, instr->ll.rt, RCX, true);
+}
+
+// AL <- condition (valid codes only, see translatable)
+static void emit_condition(Emitter* e, uint8_t cond) {
+    // Z of a pending operation is just result == 0; the other conditions have
+    // compute_pending_flags bring nzcv up to date first
+    emit_mem(e, false, 0x80, 7, R15, -1, 1, STATE_FLAG_OP(kind)); // cmp byte [kind], FLAGS_NONE
+    emit8(e, FLAGS_NONE);
+    uint8_t* up_to_date = emit_jcc(e, CC_E);
+
+    uint8_t* done = NULL;
+    if (cond == 0x0 || cond == 0x1) { // EQ, NE
+        emit_mem(e, true, 0x83, 7, R15, -1, 1, STATE_FLAG_OP(result)); // cmp qword [result], 0
+        emit8(e, 0);
+        emit8(e, 0x0f); emit8(e, cond == 0x0 ? 0x94 : 0x95); emit8(e, 0xc0); // sete/setne al
+        emit8(e, 0xe9);                                                      // jmp (over the table lookup)
+        done = e->pos;
+        emit32(e, 0);
+    } else {
+        emit_mov_rr(e, true, RDI, R15);
+        emit_mov_imm(e, RAX, (uint64_t)(uintptr_t)compute_pending_flags);
+        emit8(e, 0xff); emit8(e, 0xd0); // call rax
+    }
+
+    // Bit nzcv of the condition's row in condition_table
+    patch_here(e, up_to_date);
+    emit_mem(e, false, 0x0fb6, RAX, R15, -1, 1, STATE_NZCV); // movzx eax, byte [nzcv]
+    emit8(e, 0xb9); emit32(e, condition_table[cond]);        // mov ecx, row
+    emit8(e, 0x0f); emit8(e, 0xa3); emit8(e, 0xc1);          // bt ecx, eax
+    emit8(e, 0x0f); emit8(e, 0x92); emit8(e, 0xc0);          // setc al
+    if (done != NULL) {
+        patch_here(e, done);
+    }
+}
+
+static void emit_branch(Emitter* e, const DecodedInstruction* instr, uint64_t pc) {
+    uint64_t target = pc + ((int64_t)instr->branch.offset << 2);
+
+    switch (instr->branch.group) {
+        case 0: // B
+            emit_exit(e, true, target, true);
+            break;
+        case 1: // B.cond
+            if (instr->branch.cond == 0xE) {
+                emit_exit(e, true, target, true);
+                break;
+            }
+            emit_condition(e, instr->branch.cond);
+            emit8(e, 0x84); emit8(e, 0xc0); // test al, al
+            uint8_t* not_taken = emit_jcc(e, CC_E);
+            emit_exit(e, true, target, true);
+            patch_here(e, not_taken);
+            emit_exit(e, true, pc + 4, true);
+            break;
+        default: // BR
+            load_guest(e, RAX, instr->branch.xn, true);
+            emit_store(e, true, R15, -1, STATE_PC, RAX);
+            emit_exit(e, false, 0, true);
+            break;
+    }
+}
+
+// --- Translation ---
+
+// Instructions whose interpreter behaviour depends on reading or writing past the
+// register file (register 31 in loads/stores, BR XZR), invalid conditions and
+// literals outside memory stay with the interpreter.
+static bool translatable(const DecodeCache* cache, const DecodedInstruction* instr, uint64_t pc, bool last) {
+    switch (instr->type) {
+        case DP_IMM:
+            // A wide move with opc == 01 is unallocated and leaves its result undefined
+            return !last && !(instr->dp_imm.opi == 0x5 && instr->dp_imm.opc == 0x1);
+        case DP_REG:
+            return !last;
+        case SDT:
+            return !last && instr->sdt.rt != 31 && instr->sdt.xn != 31 &&
+                   (instr->sdt.mode != REGISTER_OFFSET || instr->sdt.xm != 31);
+        case LL: {
+            uint64_t address = pc + ((int64_t)instr->ll.simm19 << 2);
+            return !last && instr->ll.rt != 31 && address <= memory_size(cache) - (instr->sf ? 8 : 4);
+        }
+        case BRANCH:
+            if (!last) return false;
+            switch (instr->branch.group) {
+                case 0: return true;
+                case 1: {
+                    uint8_t cond = instr->branch.cond;
+                    return cond <= 0x1 || (cond >= 0xA && cond <= 0xE);
+                }
+                case 3: return instr->branch.xn != 31;
+                default: return false;
+            }
+        default:
+            return false;
+    }
+}
+
+// Counts how often each guest register is named in the block
+static void count_register_uses(const DecodedInstruction* instr, uint32_t uses[32]) {
+    switch (instr->type) {
+        case DP_IMM:
+            uses[instr->dp_imm.rd]++;
+            if (instr->dp_imm.opi == 0x2) uses[instr->dp_imm.rn]++;
+            break;
+        case DP_REG:
+            uses[instr->dp_reg.rd]++;
+            uses[instr->dp_reg.rn]++;
+            uses[instr->dp_reg.rm]++;
+            if (instr->dp_reg.M) uses[instr->dp_reg.ra]++;
+            break;
+        case SDT:
+            uses[instr->sdt.rt]++;
+            uses[instr->sdt.xn]++;
+            if (instr->sdt.mode == REGISTER_OFFSET) uses[instr->sdt.xm]++;
+            break;
+        case LL:
+            uses[instr->ll.rt]++;
+            break;
+        case BRANCH:
+            if (instr->branch.group == 3) uses[instr->branch.xn]++;
+            break;
+        default:
+            break;
+    }
+}
+
+static void allocate_registers(Emitter* e, const DecodedInstruction* block, uint32_t length) {
+    uint32_t uses[32] = {0};
+    for (uint32_t i = 0; i < length; i++) count_register_uses(&block[i], uses);
+    uses[31] = 0; // ZR is never cached
+
+    for (int reg = 0; reg < 31; reg++) e->host_of[reg] = -1;
+    for (size_t h = 0; h < GUEST_HOST_REG_COUNT; h++) {
+        int best = -1;
+        for (int reg = 0; reg < 31; reg++) {
+            if (e->host_of[reg] < 0 && uses[reg] > 0 && (best < 0 || uses[reg] > uses[best])) best = reg;
+        }
+        if (best < 0) break;
+        e->host_of[best] = guest_host_regs[h];
+    }
+}
+
+static NativeBlock jit_translate(JitCompiler* jit, const DecodedInstruction* block, uint32_t length, uint64_t pc) {
+    for (uint32_t i = 0; i < length; i++) {
+        if (!translatable(jit->cache, &block[i], pc + 4 * i, i == length - 1)) return NULL;
+    }
+
+    Emitter e;
+    e.pos = jit->code + jit->used;
+    e.end = jit->code + JIT_CODE_SIZE;
+    e.cache = jit->cache;
+    allocate_registers(&e, block, length);
+
+    uint8_t* start = e.pos;
+    emit_prologue(&e);
+    for (int reg = 0; reg < 31; reg++) {
+        if (e.host_of[reg] >= 0) emit_load(&e, true, e.host_of[reg], R15, -1, STATE_REG(reg));
+    }
+
+    for (uint32_t i = 0; i < length; i++) {
+        const DecodedInstruction* instr = &block[i];
+        uint64_t instr_pc = pc + 4 * i;
+        switch (instr->type) {
+            case DP_IMM:
+                if (instr->dp_imm.opi == 0x2) emit_dp_imm_arithmetic(&e, instr);
+                if (instr->dp_imm.opi == 0x5) emit_dp_imm_wide_move(&e, instr);
+                break; // Other opi values are no-ops
+            case DP_REG:
+                if (instr->dp_reg.M) {
+                    emit_dp_reg_multiply(&e, instr);
+                } else if (instr->dp_reg.opr >> 3) {
+                    emit_dp_reg_arithmetic(&e, instr);
+                } else {
+                    emit_dp_reg_logical(&e, instr);
+                }
+                break;
+            case SDT:
+                emit_sdt(&e, instr, instr_pc);
+                break;
+            case LL:
+                emit_load_literal(&e, instr, instr_pc);
+                break;
+            default: // BRANCH
+                emit_branch(&e, instr, instr_pc);
+                break;
+        }
+    }
+
+    if (e.pos > e.end) {
+        return NULL; // Code buffer exhausted: the rest of the run is interpreted
+    }
+    jit->used = (size_t)(e.pos - jit->code);
+    return (NativeBlock)(uintptr_t)start;
+}
+
+// --- Background compilation ---
+
+static void* jit_worker(void* arg) {
+    JitCompiler* jit = arg;
+
+    pthread_mutex_lock(&jit->lock);
+    for (;;) {
+        while (!jit->stopping && jit->pending_head == NULL) {
+            pthread_cond_wait(&jit->wake, &jit->lock);
+        }
+        if (jit->stopping) break;
+
+        JitJob* job = jit->pending_head;
+        jit->pending_head = job->next;
+        if (jit->pending_head == NULL) jit->pending_tail = NULL;
+        jit->pending_count--;
+        pthread_mutex_unlock(&jit->lock);
+
+        job->result = jit_translate(jit, job->instrs, job->length, job->pc);
+
+        // Publish: the release pairs with the main thread's acquiring exchange, so
+        // the generated code is visible before the job is
+        job->next = atomic_load_explicit(&jit->done, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&jit->done, &job->next, job,
+                                                      memory_order_release, memory_order_relaxed)) {
+        }
+        pthread_mutex_lock(&jit->lock);
+    }
+    pthread_mutex_unlock(&jit->lock);
+    return NULL;
+}
+
+JitCompiler* jit_create(DecodeCache* cache) {
+    JitCompiler* jit = calloc(1, sizeof(JitCompiler));
+    if (jit == NULL) {
+        perror("Failed to allocate JIT compiler");
+        return NULL;
+    }
+    jit->code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jit->code == MAP_FAILED) {
+        perror("Failed to map JIT code buffer");
+        free(jit);
+        return NULL;
+    }
+    jit->cache = cache;
+    pthread_mutex_init(&jit->lock, NULL);
+    pthread_cond_init(&jit->wake, NULL);
+    atomic_init(&jit->done, NULL);
+    return jit;
+}
+
+static void free_jobs(JitJob* job) {
+    while (job != NULL) {
+        JitJob* next = job->next;
+        free(job);
+        job = next;
+    }
+}
+
+void jit_free(JitCompiler* jit) {
+    if (jit == NULL) {
+        return;
+    }
+    if (jit->worker_started) {
+        pthread_mutex_lock(&jit->lock);
+        jit->stopping = true;
+        pthread_cond_signal(&jit->wake);
+        pthread_mutex_unlock(&jit->lock);
+        pthread_join(jit->worker, NULL);
+    }
+    free_jobs(jit->pending_head);
+    free_jobs(atomic_load(&jit->done));
+    pthread_cond_destroy(&jit->wake);
+    pthread_mutex_destroy(&jit->lock);
+    munmap(jit->code, JIT_CODE_SIZE);
+    free(jit);
+}
+
+bool jit_request(JitCompiler* jit, DecodedPage* page, CachedInstruction* entry, uint64_t pc) {
+    if (jit->worker_failed) return false;
+
+    uint32_t length = entry->block_length;
+    JitJob* job = malloc(sizeof(JitJob) + length * sizeof(DecodedInstruction));
+    if (job == NULL) return false;
+    job->next = NULL;
+    job->page = page;
+    job->slot = (uint32_t)(entry - page->entries);
+    job->generation = page->generation;
+    job->pc = pc;
+    job->length = length;
+    for (uint32_t i = 0; i < length; i++) job->instrs[i] = entry[i].instr;
+
+    if (pthread_mutex_trylock(&jit->lock) != 0) {
+        free(job); // The worker is busy with the queue; ask again later
+        return false;
+    }
+    if (jit->pending_count >= JIT_MAX_PENDING) {
+        pthread_mutex_unlock(&jit->lock);
+        free(job);
+        return false;
+    }
+    if (!jit->worker_started) {
+        if (pthread_create(&jit->worker, NULL, jit_worker, jit) != 0) {
+            jit->worker_failed = true;
+            pthread_mutex_unlock(&jit->lock);
+            free(job);
+            return false;
+        }
+        jit->worker_started = true;
+    }
+    if (jit->pending_tail != NULL) {
+        jit->pending_tail->next = job;
+    } else {
+        jit->pending_head = job;
+    }
+    jit->pending_tail = job;
+    jit->pending_count++;
+    pthread_cond_signal(&jit->wake);
+    pthread_mutex_unlock(&jit->lock);
+
+    entry->heat = JIT_QUEUED;
+    return true;
+}
+
+void jit_install_ready(JitCompiler* jit) {
+    if (atomic_load_explicit(&jit->done, memory_order_relaxed) == NULL) return;
+
+    JitJob* job = atomic_exchange_explicit(&jit->done, NULL, memory_order_acquire);
+    while (job != NULL) {
+        JitJob* next = job->next;
+        DecodedPage* page = job->page;
+        CachedInstruction* entry = &page->entries[job->slot];
+
+        // A store into the page since the request means the copy may be stale; the
+        // refilled slot will heat up and be requested again
+        if (page->generation == job->generation && page->tags[job->slot] == job->generation) {
+            entry->native = job->result;
+            if (job->result == NULL) entry->heat = JIT_REJECTED;
+        }
+        free(job);
+        job = next;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdint.h>
+#include "arm_state.h"
+#include "decode_cache.h"
+
+// Dynamic binary translator: compiles hot basic blocks to x86-64 host code.
+// Only built with `make JIT=1` on x86-64 hosts (JIT_ENABLED).
+//
+// A translated block keeps the guest registers it uses most in callee-saved host
+// registers and writes them back on every exit. Anything it cannot handle inline
+// (stores into pages holding code, accesses outside RAM such as GPIO, unaligned
+// stores) leaves through a side exit *before* the instruction has any effect, with
+// state->pc pointing at it, so the interpreter can carry on from there.
+//
+// Translation is tiered: blocks start out interpreted, and one entered
+// JIT_HOT_THRESHOLD times is queued for a background compiler thread. The main
+// thread keeps interpreting it meanwhile and never waits on the compiler; it picks
+// up finished blocks the next time it enters them.
+
+// CachedInstruction.heat counts block entries up to the threshold, then records
+// where the block is in the pipeline
+#define JIT_HOT_THRESHOLD 16
+#define JIT_QUEUED   UINT32_MAX       // Requested, translation not installed yet
+#define JIT_REJECTED (UINT32_MAX - 1) // Left to the interpreter for good
+
+typedef struct JitCompiler JitCompiler;
+
+// Maps the executable code buffer; returns NULL (interpret only) if that fails.
+// The compiler thread is only started by the first request.
+JitCompiler* jit_create(DecodeCache* cache);
+void jit_free(JitCompiler* jit);
+
+// Queues the block starting at entry (the slot for pc in page) for translation and
+// marks it JIT_QUEUED. Returns false without blocking if the compiler is busy or
+// its queue is full, in which case the caller asks again later.
+bool jit_request(JitCompiler* jit, DecodedPage* page, CachedInstruction* entry, uint64_t pc);
+
+// Installs finished translations whose page has not been written since they were
+// requested. Blocks the translator cannot handle become JIT_REJECTED.
+void jit_install_ready(JitCompiler* jit);
+
+#endif
@@ -0,0 +1,131 @@
+#include <string.h>
+#include "loop_idioms.h"
+#include "dp_executor.h"
+
+// --- Recognition ---
+
+// subs Xc, Xc, #step with a usable counter
+static bool is_countdown(const DecodedInstruction* instr) {
+    return instr->type == DP_IMM && instr->dp_imm.opi == 0x2 && instr->dp_imm.opc == 0x3 &&
+           instr->dp_imm.rd == instr->dp_imm.rn && instr->dp_imm.rd != 31;
+}
+
+// b.ne back to loop_pc from branch_pc
+static bool is_back_edge(const DecodedInstruction* instr, uint64_t branch_pc, uint64_t loop_pc) {
+    return instr->type == BRANCH && instr->branch.group == 1 && instr->branch.cond == 0x1 &&
+           branch_pc + ((int64_t)instr->branch.offset << 2) == loop_pc;
+}
+
+// ldr/str Xt, [Xn], #w: a post-indexed access stepping by its own width
+static bool is_streaming_access(const DecodedInstruction* instr, bool load) {
+    return instr->type == SDT && instr->sdt.L == load && instr->sdt.mode == POST_INDEXED &&
+           instr->sdt.simm9 == (instr->sf ? 8 : 4) && instr->sdt.rt != 31 && instr->sdt.xn != 31 &&
+           instr->sdt.rt != instr->sdt.xn;
+}
+
+LoopIdiom recognize_loop_idiom(const CachedInstruction* entry, uint32_t length, uint64_t pc) {
+    if (length < 2 || length > 4) return LOOP_NONE;
+    const DecodedInstruction* countdown = &entry[length - 2].instr;
+    if (!is_countdown(countdown) || !is_back_edge(&entry[length - 1].instr, pc + 4 * (length - 1), pc)) {
+        return LOOP_NONE;
+    }
+    uint8_t counter = countdown->dp_imm.rd;
+
+    if (length == 2) return LOOP_DELAY;
+
+    if (length == 3) {
+        const DecodedInstruction* store = &entry[0].instr;
+        if (is_streaming_access(store, false) && store->sdt.rt != counter && store->sdt.xn != counter) {
+            return LOOP_FILL;
+        }
+        return LOOP_NONE;
+    }
+
+    const DecodedInstruction* load = &entry[0].instr;
+    const DecodedInstruction* store = &entry[1].instr;
+    if (is_streaming_access(load, true) && is_streaming_access(store, false) && load->sf == store->sf &&
+        store->sdt.rt == load->sdt.rt && store->sdt.xn != load->sdt.xn && load->sdt.xn != counter &&
+        store->sdt.xn != counter && load->sdt.rt != counter) {
+        return LOOP_COPY;
+    }
+    return LOOP_NONE;
+}
+
+// --- Execution ---
+
+// Does [address, address + length) lie in plain RAM, clear of devices? (length > 0)
+static bool in_memory(const ARMState* state, uint64_t address, uint64_t length) {
+    return address < state->ram_end && length <= state->ram_end - address;
+}
+
+// Do [a, a + a_length) and [b, b + b_length) overlap?
+static bool overlaps(uint64_t a, uint64_t a_length, uint64_t b, uint64_t b_length) {
+    return a < b + b_length && b < a + a_length;
+}
+
+bool run_loop_idiom(ARMState* state, DecodeCache* cache, const CachedInstruction* entry) {
+    uint32_t length = entry->idiom == LOOP_DELAY ? 2 : entry->idiom == LOOP_FILL ? 3 : 4;
+    const DecodedInstruction* countdown = &entry[length - 2].instr;
+    bool sf = countdown->sf;
+    uint8_t counter = countdown->dp_imm.rd;
+    uint64_t step = (uint64_t)countdown->dp_imm.imm << (12 * countdown->dp_imm.sh);
+
+    // The loop exits on the iteration that subtracts step from step (the flags of a
+    // 32-bit subs see the untruncated result, so only an exact match gives Z), so it
+    // runs count / step times if that divides; anything else wraps around.
+    uint64_t count = sf ? state->registers[counter] : (uint32_t)state->registers[counter];
+    if (step == 0 || count == 0 || count % step != 0) return false;
+    uint64_t iterations = count / step;
+
+    uint64_t loop_pc = state->pc;
+    uint64_t loop_bytes = 4 * (uint64_t)length;
+    if (entry->idiom != LOOP_DELAY) {
+        const DecodedInstruction* store = &entry[length - 3].instr;
+        unsigned width = store->sf ? 8 : 4;
+        if (iterations > state->memory_size / width) return false;
+        uint64_t bytes = iterations * width;
+        uint64_t destination = state->registers[store->sdt.xn];
+        // Rewriting the loop's own code would change what the remaining iterations do
+        if (!in_memory(state, destination, bytes) || overlaps(destination, bytes, loop_pc, loop_bytes)) return false;
+
+        if (entry->idiom == LOOP_FILL) {
+            uint64_t value = state->registers[store->sdt.rt];
+            uint8_t pattern[8];
+            for (unsigned i = 0; i < width; i++) pattern[i] = (uint8_t)(value >> (8 * i));
+            if (memcmp(pattern, pattern + 1, width - 1) == 0) { // One repeated byte (zero-fill)
+                memset(&state->memory[destination], pattern[0], bytes);
+            } else {
+                // Lay down one element, then double the filled prefix
+                memcpy(&state->memory[destination], pattern, width);
+                for (uint64_t filled = width; filled < bytes; filled *= 2) {
+                    uint64_t chunk = filled < bytes - filled ? filled : bytes - filled;
+                    memcpy(&state->memory[destination + filled], &state->memory[destination], chunk);
+                }
+            }
+        } else {
+            const DecodedInstruction* load = &entry[0].instr;
+            uint64_t source = state->registers[load->sdt.xn];
+            // A forward word copy only behaves like memmove if it never reads a word it
+            // has already written
+            if (!in_memory(state, source, bytes) || (destination > source && destination < source + bytes)) {
+                return false;
+            }
+            // The last word loaded is still the original: earlier stores all land below it
+            state->registers[load->sdt.rt] = width == 8 ? load_le64(&state->memory[source + bytes - 8])
+                                                             : load_le32(&state->memory[source + bytes - 4]);
+            memmove(&state->memory[destination], &state->memory[source], bytes);
+            state->registers[load->sdt.xn] = source + bytes;
+        }
+        state->registers[store->sdt.xn] = destination + bytes;
+        mark_dirty_range(state, destination, bytes);
+        // decode_cache_note_store only looks at the end pages of a store; this one can
+        // span many, and any of them may hold code
+        decode_cache_invalidate(cache, destination, bytes);
+    }
+
+    // The last subs computes step - step
+    state->registers[counter] = 0;
+    update_flags(state, 0, step, step, FLAGS_SUBS, sf);
+    state->pc = loop_pc + loop_bytes;
+    return true;
+}
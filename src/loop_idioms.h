@@ -0,0 +1,37 @@
+#ifndef LOOP_IDIOMS_H
+#define LOOP_IDIOMS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "arm_state.h"
+#include "decode_cache.h"
+
+// Loop idiom accelerator.
+// A block that branches back to itself and matches one of the idioms below is run
+// to completion in one step: the counter, pointers and flags are computed in closed
+// form and the memory it writes is filled or copied on the host. The architectural
+// state afterwards is exactly that of running the loop instruction by instruction.
+//
+// Every idiom counts down with `subs Xc, Xc, #step` followed by `b.ne <loop>`:
+//   LOOP_DELAY   subs; b.ne                                    (busy-wait)
+//   LOOP_FILL    str Xv, [Xd], #w; subs; b.ne                  (memset)
+//   LOOP_COPY    ldr Xt, [Xs], #w; str Xt, [Xd], #w; subs; b.ne (memcpy)
+// where w is the access width and all registers are distinct and not 31.
+typedef enum {
+    LOOP_NONE,
+    LOOP_DELAY,
+    LOOP_FILL,
+    LOOP_COPY,
+} LoopIdiom;
+
+// Classifies the block of length instructions starting at entry (address pc)
+LoopIdiom recognize_loop_idiom(const CachedInstruction* entry, uint32_t length, uint64_t pc);
+
+// Runs the idiom block at state->pc (entry->idiom != LOOP_NONE) to completion,
+// leaving the PC after its branch. Returns false without changing anything if this
+// instance cannot be done in closed form (counter not a multiple of the step,
+// memory out of range, overlapping copy, a store over the loop itself), in which
+// case the block is executed normally.
+bool run_loop_idiom(ARMState* state, DecodeCache* cache, const CachedInstruction* entry);
+
+#endif
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "snapshot.h"
+#include "arm_state.h"
+
+// Compares two final-state snapshots: ./snapdiff <snapshot_a> <snapshot_b>
+// Equal hashes settle it from the two headers alone. Otherwise every register,
+// flag and memory word that differs is listed, one per line, like the text dump.
+// Exits with 0 if the snapshots match, 1 if they differ and 2 on errors.
+
+static const uint8_t zero_page[MEMORY_PAGE_SIZE];
+
+static void print_flags(uint32_t nzcv) {
+    printf("%c%c%c%c", nzcv & FLAG_N ? 'N' : '-', nzcv & FLAG_Z ? 'Z' : '-', nzcv & FLAG_C ? 'C' : '-',
+           nzcv & FLAG_V ? 'V' : '-');
+}
+
+// Prints the words of one page that differ; returns how many there were
+static unsigned diff_page(uint32_t page, const uint8_t* a, const uint8_t* b) {
+    if (memcmp(a, b, MEMORY_PAGE_SIZE) == 0) return 0;
+    unsigned differences = 0;
+    for (uint32_t offset = 0; offset < MEMORY_PAGE_SIZE; offset += 4) {
+        uint32_t word_a = load_le32(a + offset), word_b = load_le32(b + offset);
+        if (word_a != word_b) {
+            printf("0x%08x: %08x != %08x\n", (page << MEMORY_PAGE_SHIFT) + offset, word_a, word_b);
+            differences++;
+        }
+    }
+    return differences;
+}
+
+static unsigned diff_snapshots(const Snapshot* a, const Snapshot* b) {
+    const SnapshotHeader* ha = a->header;
+    const SnapshotHeader* hb = b->header;
+    unsigned differences = 0;
+    for (int i = 0; i < 31; i++) {
+        if (ha->registers[i] != hb->registers[i]) {
+            printf("X%02d = %016" PRIx64 " != %016" PRIx64 "\n", i, ha->registers[i], hb->registers[i]);
+            differences++;
+        }
+    }
+    if (ha->pc != hb->pc) {
+        printf("PC = %016" PRIx64 " != %016" PRIx64 "\n", ha->pc, hb->pc);
+        differences++;
+    }
+    if (ha->nzcv != hb->nzcv) {
+        printf("PSTATE : ");
+        print_flags(ha->nzcv);
+        printf(" != ");
+        print_flags(hb->nzcv);
+        printf("\n");
+        differences++;
+    }
+
+    // Both page lists are sorted: merge them, a page missing from one side being zero
+    uint32_t i = 0, j = 0;
+    while (i < ha->page_count || j < hb->page_count) {
+        const SnapshotPage* page_a = i < ha->page_count ? &a->pages[i] : NULL;
+        const SnapshotPage* page_b = j < hb->page_count ? &b->pages[j] : NULL;
+        if (page_a && (!page_b || page_a->page < page_b->page)) {
+            differences += diff_page(page_a->page, page_a->bytes, zero_page);
+            i++;
+        } else if (page_b && (!page_a || page_b->page < page_a->page)) {
+            differences += diff_page(page_b->page, zero_page, page_b->bytes);
+            j++;
+        } else {
+            differences += diff_page(page_a->page, page_a->bytes, page_b->bytes);
+            i++;
+            j++;
+        }
+    }
+    return differences;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <snapshot_a> <snapshot_b>\n", argv[0]);
+        return 2;
+    }
+
+    SnapshotHeader header_a, header_b;
+    if (!read_snapshot_header(argv[1], &header_a) || !read_snapshot_header(argv[2], &header_b)) {
+        return 2;
+    }
+    if (header_a.hash == header_b.hash) {
+        printf("Snapshots match (hash %016" PRIx64 ")\n", header_a.hash);
+        return 0;
+    }
+
+    Snapshot a, b;
+    if (!open_snapshot(argv[1], &a)) return 2;
+    if (!open_snapshot(argv[2], &b)) {
+        close_snapshot(&a);
+        return 2;
+    }
+    printf("Snapshots differ (hash %016" PRIx64 " != %016" PRIx64 ")\n", header_a.hash, header_b.hash);
+    unsigned differences = diff_snapshots(&a, &b);
+    printf("%u difference%s\n", differences, differences == 1 ? "" : "s");
+    close_snapshot(&a);
+    close_snapshot(&b);
+    return 1;
+}
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+#include "content_hash.h"
+
+bool read_snapshot_header(const char* path, SnapshotHeader* header) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open snapshot '%s'\n", path);
+        return false;
+    }
+    ssize_t got = read(fd, header, sizeof(*header));
+    close(fd);
+    if (got != (ssize_t)sizeof(*header) || memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0) {
+        fprintf(stderr, "Error: '%s' is not a snapshot\n", path);
+        return false;
+    }
+    return true;
+}
+
+bool open_snapshot(const char* path, Snapshot* snapshot) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open snapshot '%s'\n", path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        fprintf(stderr, "Error: '%s' is not a snapshot\n", path);
+        return false;
+    }
+    size_t size = (size_t)info.st_size;
+    const uint8_t* file = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED) {
+        perror("Failed to map snapshot");
+        return false;
+    }
+
+    const SnapshotHeader* header = (const SnapshotHeader*)file;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        size != sizeof(SnapshotHeader) + (size_t)header->page_count * sizeof(SnapshotPage)) {
+        munmap((void*)file, size);
+        fprintf(stderr, "Error: '%s' is not a snapshot\n", path);
+        return false;
+    }
+    if (content_hash(file + SNAPSHOT_HASHED_OFFSET, size - SNAPSHOT_HASHED_OFFSET) != header->hash) {
+        munmap((void*)file, size);
+        fprintf(stderr, "Error: Snapshot '%s' is corrupt (hash mismatch)\n", path);
+        return false;
+    }
+
+    snapshot->header = header;
+    snapshot->pages = (const SnapshotPage*)(file + sizeof(SnapshotHeader));
+    snapshot->size = size;
+    return true;
+}
+
+void close_snapshot(Snapshot* snapshot) {
+    munmap((void*)snapshot->header, snapshot->size);
+    snapshot->header = NULL;
+    snapshot->pages = NULL;
+    snapshot->size = 0;
+}
@@ -0,0 +1,51 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "constants.h"
+
+// Binary final-state snapshot (`emulate -s`), the compact alternative to the text
+// dump of print_final_state. It holds the registers, PC and NZCV flags, then every
+// memory page with a non-zero byte, in address order. The header carries a 64-bit
+// content hash of everything after it, so two snapshots are compared by reading
+// only their headers; `snapdiff` looks at the rest only when the hashes differ.
+
+// Bump the version whenever the layout changes
+#define SNAPSHOT_MAGIC "ARMSSv1"
+
+typedef struct {
+    char magic[8];
+    uint64_t hash;          // content_hash of the bytes from registers to the end of the file
+    uint64_t registers[31]; // X0-X30
+    uint64_t pc;
+    uint32_t nzcv;          // FLAG_N | FLAG_Z | FLAG_C | FLAG_V
+    uint32_t page_count;    // SnapshotPage records that follow
+} SnapshotHeader;
+
+typedef struct {
+    uint32_t page; // Guest address >> MEMORY_PAGE_SHIFT
+    uint8_t bytes[MEMORY_PAGE_SIZE];
+} SnapshotPage;
+
+// Offset of the hashed part of a snapshot
+#define SNAPSHOT_HASHED_OFFSET offsetof(SnapshotHeader, registers)
+
+// A snapshot file mapped read-only
+typedef struct {
+    const SnapshotHeader* header;
+    const SnapshotPage* pages; // header->page_count of them, by ascending page
+    size_t size;
+} Snapshot;
+
+// Reads just the header of the snapshot at path. Returns false (after reporting why)
+// if it is not a snapshot.
+bool read_snapshot_header(const char* path, SnapshotHeader* header);
+
+// Maps the snapshot at path and checks its layout and hash. Returns false (after
+// reporting why) if it is not a valid snapshot.
+bool open_snapshot(const char* path, Snapshot* snapshot);
+void close_snapshot(Snapshot* snapshot);
+
+#endif
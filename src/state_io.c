@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "state_io.h"
+#include "dp_executor.h"
+#include "content_hash.h"
+#include "snapshot.h"
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Maps the first size bytes of file over the start of guest memory, copy-on-write:
+// pages are read in on first access, shared with every other process mapping the
+// image, and only copied when the guest writes them. Bytes past the end of the
+// file in its last page read as zero, as loaded memory would. Returns false (with
+// memory untouched) if file cannot be mapped there.
+static bool map_image(ARMState* state, FILE* file, size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t length = (size + page - 1) & ~(page - 1);
+    if (length > state->memory_size) return false; // Would cover host memory past the guest's
+
+    void* mapped = mmap(state->memory, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fileno(file), 0);
+    if (mapped != MAP_FAILED) return true;
+    // Make sure the range is plain zeroed memory again before falling back to fread
+    mmap(state->memory, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    return false;
+}
+
+size_t load_binary_to_memory(const char* filename, ARMState* state) {
+    FILE* file = fopen(filename, "rb"); 
+    if (!file) {
+        fprintf(stderr, "Error: Could not open input file '%s'\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    // Regular files are mapped rather than read, so loading costs the same for any size
+    struct stat info;
+    if (fstat(fileno(file), &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        size_t size = (uint64_t)info.st_size < state->memory_size ? (size_t)info.st_size : state->memory_size;
+        if (map_image(state, file, size)) {
+            if ((uint64_t)info.st_size > state->memory_size) {
+                fprintf(stderr, "Warning: Input file '%s' is larger than the %" PRIu64 "-byte memory capacity. Only the first %" PRIu64 " bytes loaded.\n",
+                        filename, state->memory_size, state->memory_size);
+            }
+            mark_dirty_range(state, 0, size);
+            fclose(file); // The mapping keeps its own reference to the file
+            fprintf(stderr, "Loaded %zu bytes from '%s' into memory.\n", size, filename);
+            return size;
+        }
+    }
+
+    // Otherwise read the entire file into memory
+    size_t element_size = 1; // Size of each element (1 byte)
+    size_t max_elements_to_read = state->memory_size; // Max total bytes to read
+
+    size_t elements_read = fread(state->memory, element_size, max_elements_to_read, file);
+    size_t bytes_read_total = elements_read * element_size; // Calculate total bytes read
+
+
+    if (elements_read == 0 && !feof(file)) { // Check if it's an actual read error, not just empty file
+        fprintf(stderr, "Error: Could not read from input file '%s'\n", filename);
+        fclose(file);
+        exit(EXIT_FAILURE);
+    }
+    if (bytes_read_total == state->memory_size && fgetc(file) != EOF) {
+        fprintf(stderr, "Warning: Input file '%s' is larger than the %" PRIu64 "-byte memory capacity. Only the first %" PRIu64 " bytes loaded.\n",
+                filename, state->memory_size, state->memory_size);
+    }
+
+    mark_dirty_range(state, 0, bytes_read_total);
+    fclose(file);
+    fprintf(stderr, "Loaded %zu bytes from '%s' into memory.\n", bytes_read_total, filename);
+    return bytes_read_total;
+}
+
+// Bytes tested for zero at once; divides MEMORY_PAGE_SIZE
+#define ZERO_CHUNK 64
+
+static inline bool chunk_is_zero(const uint8_t* bytes) {
+#if defined(__AVX2__)
+    __m256i any = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)bytes),
+                                  _mm256_loadu_si256((const __m256i*)(bytes + 32)));
+    return _mm256_testz_si256(any, any);
+#elif defined(__SSE2__)
+    __m128i any = _mm_or_si128(_mm_or_si128(_mm_loadu_si128((const __m128i*)bytes),
+                                            _mm_loadu_si128((const __m128i*)(bytes + 16))),
+                               _mm_or_si128(_mm_loadu_si128((const __m128i*)(bytes + 32)),
+                                            _mm_loadu_si128((const __m128i*)(bytes + 48))));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) == 0xFFFF;
+#else
+    uint64_t any = 0;
+    for (unsigned i = 0; i < ZERO_CHUNK; i += 8) {
+        uint64_t lane;
+        memcpy(&lane, bytes + i, sizeof(lane));
+        any |= lane;
+    }
+    return any == 0;
+#endif
+}
+
+// --- Final state dump ---
+// The dump is formatted by hand into one large buffer and handed to the kernel with a
+// single write, rather than through one fprintf per line. Dumps bigger than the buffer
+// (thousands of non-zero words) take one write per DUMP_BUFFER_SIZE bytes.
+
+#define DUMP_BUFFER_SIZE (1 << 20)
+#define DUMP_LINE_MAX 32 // Longest line of the dump, with room to spare
+
+// "00" "01" ... "ff": the two hex digits of every byte value
+#define HEX_ROW(high) high "0" high "1" high "2" high "3" high "4" high "5" high "6" high "7" \
+                      high "8" high "9" high "a" high "b" high "c" high "d" high "e" high "f"
+static const char hex_pairs[] = HEX_ROW("0") HEX_ROW("1") HEX_ROW("2") HEX_ROW("3") HEX_ROW("4") HEX_ROW("5")
+                                HEX_ROW("6") HEX_ROW("7") HEX_ROW("8") HEX_ROW("9") HEX_ROW("a") HEX_ROW("b")
+                                HEX_ROW("c") HEX_ROW("d") HEX_ROW("e") HEX_ROW("f");
+
+typedef struct {
+    char data[DUMP_BUFFER_SIZE];
+    size_t length;
+    int fd;
+    bool failed; // A write failed; the rest of the dump is dropped
+} DumpBuffer;
+
+static DumpBuffer dump_buffer; // Static: too big for the stack
+
+// Returns false (after reporting why) if the bytes could not all be written
+static bool write_all(int fd, const char* bytes, size_t length) {
+    while (length > 0) {
+        ssize_t result = write(fd, bytes, length);
+        if (result < 0) {
+            perror("Failed to write the final state");
+            return false;
+        }
+        bytes += result;
+        length -= (size_t)result;
+    }
+    return true;
+}
+
+static void dump_flush(DumpBuffer* dump) {
+    if (!dump->failed && !write_all(dump->fd, dump->data, dump->length)) {
+        dump->failed = true;
+    }
+    dump->length = 0;
+}
+
+// Makes room for one more line
+static inline char* dump_line(DumpBuffer* dump) {
+    if (dump->length > DUMP_BUFFER_SIZE - DUMP_LINE_MAX) dump_flush(dump);
+    return dump->data + dump->length;
+}
+
+static inline char* put_text(char* out, const char* text, size_t length) {
+    memcpy(out, text, length);
+    return out + length;
+}
+
+// The low `bytes` bytes of value as 2 * bytes lowercase hex digits, like %0*x
+static inline char* put_hex(char* out, uint64_t value, unsigned bytes) {
+    for (unsigned i = bytes; i-- > 0;) {
+        memcpy(out, &hex_pairs[2 * ((value >> (8 * i)) & 0xff)], 2);
+        out += 2;
+    }
+    return out;
+}
+
+#define PUT_LITERAL(out, text) put_text(out, text, sizeof(text) - 1)
+
+void print_final_state(ARMState* state, FILE* output_file) {
+    DumpBuffer* dump = &dump_buffer;
+    // Whatever the emulation printed to output_file (GPIO messages) comes first
+    fflush(output_file);
+    dump->fd = fileno(output_file);
+    dump->length = 0;
+    dump->failed = false;
+
+    char* out = dump_line(dump);
+    out = PUT_LITERAL(out, "Registers:\n");
+    dump->length = out - dump->data;
+    for (int i = 0; i < 31; ++i) { // X%02d = %016llx
+        out = dump_line(dump);
+        *out++ = 'X';
+        *out++ = (char)('0' + i / 10);
+        *out++ = (char)('0' + i % 10);
+        out = PUT_LITERAL(out, " = ");
+        out = put_hex(out, state->registers[i], 8);
+        *out++ = '\n';
+        dump->length = out - dump->data;
+    }
+    out = dump_line(dump);
+    out = PUT_LITERAL(out, "PC = ");
+    out = put_hex(out, state->pc, 8);
+    *out++ = '\n';
+    dump->length = out - dump->data;
+
+    materialize_flags(state);
+    out = dump_line(dump);
+    out = PUT_LITERAL(out, "PSTATE : ");
+    *out++ = state->nzcv & FLAG_N ? 'N' : '-';
+    *out++ = state->nzcv & FLAG_Z ? 'Z' : '-';
+    *out++ = state->nzcv & FLAG_C ? 'C' : '-';
+    *out++ = state->nzcv & FLAG_V ? 'V' : '-';
+    *out++ = '\n';
+    dump->length = out - dump->data;
+
+    out = dump_line(dump);
+    out = PUT_LITERAL(out, "Non-zero memory:\n");
+    dump->length = out - dump->data;
+    // Pages never loaded or written are still zero; the others are skipped a chunk at a time
+    for (uint64_t page = 0; page < state->memory_size >> MEMORY_PAGE_SHIFT; page++) {
+        if (!state->dirty_pages[page]) continue;
+        for (uint32_t chunk = page << MEMORY_PAGE_SHIFT; chunk < (page + 1) << MEMORY_PAGE_SHIFT; chunk += ZERO_CHUNK) {
+            if (chunk_is_zero(&state->memory[chunk])) continue;
+            for (uint32_t addr = chunk; addr < chunk + ZERO_CHUNK; addr += 4) {
+                uint32_t word = load_le32(&state->memory[addr]);
+                if (word != 0) { // 0x%08x: %08x
+                    out = dump_line(dump);
+                    out = PUT_LITERAL(out, "0x");
+                    out = put_hex(out, addr, 4);
+                    out = PUT_LITERAL(out, ": ");
+                    out = put_hex(out, word, 4);
+                    *out++ = '\n';
+                    dump->length = out - dump->data;
+                }
+            }
+        }
+    }
+    dump_flush(dump);
+}
+
+// Does the dirty page at address hold a non-zero byte?
+static bool page_is_nonzero(const ARMState* state, uint64_t address) {
+    for (uint64_t chunk = address; chunk < address + MEMORY_PAGE_SIZE; chunk += ZERO_CHUNK) {
+        if (!chunk_is_zero(&state->memory[chunk])) return true;
+    }
+    return false;
+}
+
+bool write_snapshot(ARMState* state, FILE* output_file) {
+    uint64_t page_total = state->memory_size >> MEMORY_PAGE_SHIFT;
+    uint32_t page_count = 0;
+    for (uint64_t page = 0; page < page_total; page++) {
+        page_count += state->dirty_pages[page] && page_is_nonzero(state, page << MEMORY_PAGE_SHIFT);
+    }
+
+    size_t size = sizeof(SnapshotHeader) + (size_t)page_count * sizeof(SnapshotPage);
+    uint8_t* snapshot = calloc(1, size); // Zeroed, so padding hashes the same every time
+    if (!snapshot) {
+        perror("Failed to allocate the snapshot");
+        return false;
+    }
+    SnapshotHeader* header = (SnapshotHeader*)snapshot;
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+    memcpy(header->registers, state->registers, sizeof(header->registers));
+    header->pc = state->pc;
+    materialize_flags(state);
+    header->nzcv = state->nzcv;
+    header->page_count = page_count;
+
+    SnapshotPage* pages = (SnapshotPage*)(snapshot + sizeof(SnapshotHeader));
+    for (uint64_t page = 0; page < page_total; page++) {
+        uint64_t address = page << MEMORY_PAGE_SHIFT;
+        if (!state->dirty_pages[page] || !page_is_nonzero(state, address)) continue;
+        pages->page = (uint32_t)page;
+        memcpy(pages->bytes, &state->memory[address], MEMORY_PAGE_SIZE);
+        pages++;
+    }
+    header->hash = content_hash(snapshot + SNAPSHOT_HASHED_OFFSET, size - SNAPSHOT_HASHED_OFFSET);
+
+    fflush(output_file);
+    bool written = write_all(fileno(output_file), (const char*)snapshot, size);
+    free(snapshot);
+    return written;
+}
@@ -0,0 +1,19 @@
+#ifndef STATE_IO_H
+#define STATE_IO_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "arm_state.h"
+
+// Loads a flat binary image at address 0 (at most state->memory_size bytes), mapping
+// it copy-on-write where possible, and returns its size; exits on error
+size_t load_binary_to_memory(const char* filename, ARMState* state);
+
+// Writes registers, PC, PSTATE and every non-zero memory word to output_file
+void print_final_state(ARMState* state, FILE* output_file);
+
+// Writes the same state as a binary snapshot (see snapshot.h) to output_file.
+// Returns false (after reporting why) if it could not be written.
+bool write_snapshot(ARMState* state, FILE* output_file);
+
+#endif
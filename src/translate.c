@@ -0,0 +1,504 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "decoder.h"
+#include "dp_executor.h"
+#include "shifts.h"
+#include "constants.h"
+
+// Ahead-of-time translator: turns a flat guest image into a C translation unit
+// that runs it natively when linked with aot_runtime.o and the interpreter.
+//
+// Code is discovered by following control flow from address 0. Every reachable
+// instruction is emitted as C in address order, with guest registers and flags in
+// local variables and static branches lowered to gotos; BR goes through a switch
+// over all branch targets. Whatever the translation cannot reproduce exactly (BR
+// to other addresses, accesses outside RAM such as GPIO, HALT, unknown
+// instructions, branches to self, register 31 quirks, stores over translated code)
+// leaves to the interpreter with the state written back, so the output is the same
+// as running the image with emulate.
+
+typedef struct {
+    uint32_t word_count;
+    DecodedInstruction* instrs;
+    uint8_t* reachable; // Per word: discovered as code
+    uint8_t* label;     // Per word: needs a label (entry or branch target)
+} Image;
+
+static uint64_t branch_target(const DecodedInstruction* instr, uint64_t pc) {
+    return pc + ((int64_t)instr->branch.offset << 2);
+}
+
+// Targets the translation can jump to directly: translated code other than the
+// branch itself (branches to self stall, which the interpreter reports)
+static bool static_target(const Image* image, uint64_t target, uint64_t pc) {
+    return target != pc && target < (uint64_t)image->word_count * 4;
+}
+
+static bool valid_condition(uint8_t cond) {
+    return cond <= 0x1 || (cond >= 0xA && cond <= 0xE);
+}
+
+// Instructions translated inline; the rest exit to the interpreter
+static bool translatable(const Image* image, const DecodedInstruction* instr, uint64_t pc) {
+    switch (instr->type) {
+        case DP_IMM:
+            return !(instr->dp_imm.opi == 0x5 && instr->dp_imm.opc == 0x1);
+        case DP_REG:
+            return true;
+        case SDT:
+            return instr->sdt.rt != 31 && instr->sdt.xn != 31 &&
+                   (instr->sdt.mode != REGISTER_OFFSET || instr->sdt.xm != 31);
+        case LL: {
+            uint64_t address = pc + ((int64_t)instr->ll.simm19 << 2);
+            return instr->ll.rt != 31 && address <= MEMORY_SIZE - (instr->sf ? 8 : 4);
+        }
+        case BRANCH:
+            switch (instr->branch.group) {
+                case 0: return static_target(image, branch_target(instr, pc), pc);
+                case 1: return valid_condition(instr->branch.cond);
+                case 3: return instr->branch.xn != 31;
+                default: return false;
+            }
+        default:
+            return false;
+    }
+}
+
+static bool falls_through(const DecodedInstruction* instr) {
+    return instr->type != BRANCH || instr->branch.group == 1;
+}
+
+// Marks everything reachable from address 0 and the labels it needs
+static void discover(Image* image) {
+    uint32_t* stack = malloc(sizeof(uint32_t) * (image->word_count + 1));
+    if (stack == NULL) {
+        perror("Failed to allocate work list");
+        exit(EXIT_FAILURE);
+    }
+    size_t depth = 0;
+    if (image->word_count > 0) {
+        stack[depth++] = 0;
+        image->label[0] = 1;
+    }
+
+    while (depth > 0) {
+        uint32_t index = stack[--depth];
+        if (image->reachable[index]) continue;
+        image->reachable[index] = 1;
+
+        uint64_t pc = (uint64_t)index * 4;
+        const DecodedInstruction* instr = &image->instrs[index];
+        if (!translatable(image, instr, pc)) continue;
+
+        if (instr->type == BRANCH && instr->branch.group != 3) {
+            uint64_t target = branch_target(instr, pc);
+            if (static_target(image, target, pc)) {
+                image->label[target / 4] = 1;
+                stack[depth++] = (uint32_t)(target / 4);
+            }
+        }
+        if (falls_through(instr) && index + 1 < image->word_count) {
+            stack[depth++] = index + 1;
+        }
+    }
+    free(stack);
+}
+
+// --- C emission ---
+
+static void emit_exit(FILE* out, uint64_t pc) {
+    fprintf(out, "{ state->pc = 0x%" PRIx64 "; goto leave; }", pc);
+}
+
+// Operand read with execute_* semantics: ZR reads 0, W registers zero-extend
+static void emit_read(FILE* out, uint8_t reg, bool sf) {
+    if (reg == 31) {
+        fprintf(out, "0");
+    } else if (sf) {
+        fprintf(out, "x%d", reg);
+    } else {
+        fprintf(out, "(uint32_t)x%d", reg);
+    }
+}
+
+// Register write: ZR writes are ignored, W writes clear the upper half
+static void emit_write(FILE* out, uint8_t reg, const char* value, bool sf) {
+    if (reg == 31) return;
+    if (sf) {
+        fprintf(out, " x%d = %s;", reg, value);
+    } else {
+        fprintf(out, " x%d = (uint32_t)%s;", reg, value);
+    }
+}
+
+// PSTATE update matching update_flags() for result r and operands a, b
+static void emit_flags(FILE* out, FlagUpdate kind, bool sf) {
+    fprintf(out, " N = (r >> %d) & 1; Z = r == 0;", sf ? 63 : 31);
+    switch (kind) {
+        case FLAGS_ADDS:
+            fprintf(out, " C = r < a; V = ((int64_t)a > 0 && (int64_t)b > 0 && (int64_t)r < 0) ||"
+                         " ((int64_t)a < 0 && (int64_t)b < 0 && (int64_t)r > 0);");
+            break;
+        case FLAGS_SUBS:
+            fprintf(out, " C = a >= b; V = ((int64_t)a > 0 && (int64_t)b < 0 && (int64_t)r < 0) ||"
+                         " ((int64_t)a < 0 && (int64_t)b > 0 && (int64_t)r > 0);");
+            break;
+        case FLAGS_LOGICAL:
+            fprintf(out, " C = 0; V = 0;");
+            break;
+        case FLAGS_NZ:
+        case FLAGS_NONE:
+            break;
+    }
+}
+
+// Shifts operand b in place, matching execute_shift
+static void emit_shift(FILE* out, const DecodedInstruction* instr) {
+    bool sf = instr->sf;
+    unsigned amount = instr->dp_reg.shift_amount;
+    ShiftType type = (ShiftType)instr->dp_reg.shift_type;
+
+    if (type == SHIFT_ROR) amount %= sf ? 64 : 32;
+    if (amount == 0) return;
+
+    if (!sf && amount >= 32) {
+        // Everything is shifted out of the 32-bit value
+        fprintf(out, type == SHIFT_ASR ? " b = (b >> 31) ? 0xffffffffu : 0;" : " b = 0;");
+        return;
+    }
+    switch (type) {
+        case SHIFT_LSL:
+            fprintf(out, sf ? " b = b << %u;" : " b = (uint32_t)(b << %u);", amount);
+            break;
+        case SHIFT_LSR:
+            fprintf(out, " b = b >> %u;", amount);
+            break;
+        case SHIFT_ASR:
+            fprintf(out, sf ? " b = (uint64_t)((int64_t)b >> %u);" : " b = (uint32_t)((int32_t)(uint32_t)b >> %u);",
+                    amount);
+            break;
+        case SHIFT_ROR:
+            if (sf) {
+                fprintf(out, " b = (b >> %u) | (b << %u);", amount, 64 - amount);
+            } else {
+                fprintf(out, " b = (uint32_t)((b >> %u) | (b << %u));", amount, 32 - amount);
+            }
+            break;
+    }
+}
+
+static void emit_dp_imm(FILE* out, const DecodedInstruction* instr) {
+    bool sf = instr->sf;
+    uint8_t opc = instr->dp_imm.opc;
+
+    if (instr->dp_imm.opi == 0x2 && (instr->dp_imm.rd != 31 || (opc & 0x1))) { // Arithmetic
+        uint64_t imm = (uint64_t)instr->dp_imm.imm << (instr->dp_imm.sh ? 12 : 0);
+        fprintf(out, "{ uint64_t a = ");
+        emit_read(out, instr->dp_imm.rn, sf);
+        fprintf(out, ", b = 0x%" PRIx64 ", r = a %c b;", imm, (opc & 0x2) ? '-' : '+');
+        emit_write(out, instr->dp_imm.rd, "r", sf);
+        if (opc & 0x1) emit_flags(out, (opc & 0x2) ? FLAGS_SUBS : FLAGS_ADDS, sf);
+        fprintf(out, " }");
+    } else if (instr->dp_imm.opi == 0x5) { // Wide move
+        uint8_t hw_shift = instr->dp_imm.hw * 16;
+        uint64_t operand_to_move = (uint64_t)instr->dp_imm.imm << hw_shift;
+        char value[96];
+        switch (opc) {
+            case 0x00: // MOVN
+                snprintf(value, sizeof(value), "0x%" PRIx64 "u",
+                         sf ? ~operand_to_move : (uint32_t)(~operand_to_move));
+                break;
+            case 0x02: // MOVZ
+                snprintf(value, sizeof(value), "0x%" PRIx64 "u", operand_to_move);
+                break;
+            default: { // MOVK
+                uint64_t mask_16bit_at_pos = (sf ? 0xFFFFULL : 0xFFFFU) << hw_shift;
+                snprintf(value, sizeof(value), "((%sx%d & 0x%" PRIx64 "u) | 0x%" PRIx64 "u)",
+                         sf ? "" : "(uint32_t)", instr->dp_imm.rd, ~mask_16bit_at_pos, operand_to_move);
+                break;
+            }
+        }
+        if (instr->dp_imm.rd != 31) {
+            fprintf(out, "{");
+            emit_write(out, instr->dp_imm.rd, value, sf);
+            fprintf(out, " }");
+        }
+    }
+}
+
+static void emit_dp_reg(FILE* out, const DecodedInstruction* instr) {
+    bool sf = instr->sf;
+    uint8_t opc = instr->dp_reg.opc;
+    uint8_t rd = instr->dp_reg.rd;
+
+    if (instr->dp_reg.M && rd == 31) return; // Multiply into ZR has no effect
+
+    fprintf(out, "{ uint64_t a = ");
+    emit_read(out, instr->dp_reg.rn, sf);
+    fprintf(out, ", b = ");
+    emit_read(out, instr->dp_reg.rm, sf);
+    fprintf(out, ";");
+
+    if (instr->dp_reg.M) { // Multiply
+        fprintf(out, " uint64_t c = ");
+        emit_read(out, instr->dp_reg.ra, sf);
+        fprintf(out, sf ? "; uint64_t p = a * b;" : "; uint64_t p = (uint64_t)((uint32_t)a * (uint32_t)b);");
+        fprintf(out, " uint64_t r = c %c p;", instr->dp_reg.x ? '-' : '+');
+        emit_write(out, rd, "r", sf);
+    } else if (instr->dp_reg.opr >> 3) { // Arithmetic
+        emit_shift(out, instr);
+        fprintf(out, " uint64_t r = a %c b;", (opc & 0x2) ? '-' : '+');
+        if (!sf) fprintf(out, " r = (uint32_t)r;");
+        emit_write(out, rd, "r", sf);
+        if ((opc & 0x1) || rd == 31) {
+            emit_flags(out, opc == 0x1 ? FLAGS_ADDS : opc == 0x3 ? FLAGS_SUBS : FLAGS_NZ, sf);
+        }
+    } else { // Logical
+        static const char ops[] = { '&', '|', '^', '&' };
+        emit_shift(out, instr);
+        if (instr->dp_reg.N) fprintf(out, sf ? " b = ~b;" : " b = (uint32_t)~b;");
+        fprintf(out, " uint64_t r = a %c b;", ops[opc]);
+        if (opc == 0x3 || rd == 31) emit_flags(out, FLAGS_LOGICAL, sf);
+        emit_write(out, rd, "r", sf);
+    }
+    fprintf(out, " }");
+}
+
+static void emit_sdt(FILE* out, const DecodedInstruction* instr, uint64_t pc) {
+    bool sf = instr->sf;
+    unsigned width = sf ? 8 : 4;
+    uint8_t xn = instr->sdt.xn;
+
+    fprintf(out, "{ uint64_t base = x%d, address = ", xn);
+    switch ((addressing_mode)instr->sdt.mode) {
+        case UNSIGNED_IMMEDIATE:
+            fprintf(out, "base + %u;", (unsigned)instr->sdt.imm12 << (sf ? 3 : 2));
+            break;
+        case PRE_INDEXED:
+            fprintf(out, "base + (uint64_t)(int64_t)%d;", instr->sdt.simm9);
+            break;
+        case POST_INDEXED:
+            fprintf(out, "base;");
+            break;
+        default: // REGISTER_OFFSET
+            fprintf(out, "base + x%d;", instr->sdt.xm);
+            break;
+    }
+
+    // Only RAM is accessed inline (GPIO lives past the end of memory)
+    fprintf(out, "\n        if (address > %u) ", MEMORY_SIZE - width);
+    emit_exit(out, pc);
+    fprintf(out, "\n       ");
+    if (instr->sdt.mode == PRE_INDEXED || instr->sdt.mode == POST_INDEXED) {
+        fprintf(out, " x%d = base + (uint64_t)(int64_t)%d;", xn, instr->sdt.simm9);
+    }
+    if (instr->sdt.L) {
+        fprintf(out, " x%d = aot_load%u(state->memory + address); }", instr->sdt.rt, width * 8);
+    } else {
+        fprintf(out, " aot_store%u(state, address, %sx%d);", width * 8, sf ? "" : "(uint32_t)",
+                instr->sdt.rt);
+        // Rewritten code is only correct in the interpreter
+        fprintf(out, "\n        if (aot_touches_code(code_map, CODE_WORDS, address, %u)) ", width);
+        emit_exit(out, pc + 4);
+        fprintf(out, " }");
+    }
+}
+
+static void emit_condition(FILE* out, uint8_t cond) {
+    switch (cond) {
+        case 0x0: fprintf(out, "Z"); break;
+        case 0x1: fprintf(out, "!Z"); break;
+        case 0xA: fprintf(out, "N == V"); break;
+        case 0xB: fprintf(out, "N != V"); break;
+        case 0xC: fprintf(out, "!Z && N == V"); break;
+        case 0xD: fprintf(out, "!(!Z && N == V)"); break;
+        default: fprintf(out, "1"); break; // AL
+    }
+}
+
+static void emit_branch(FILE* out, const Image* image, const DecodedInstruction* instr, uint64_t pc) {
+    uint64_t target = branch_target(instr, pc);
+
+    switch (instr->branch.group) {
+        case 0: // B (static_target holds, see translatable)
+            fprintf(out, "goto L_%08" PRIx64 ";", target);
+            break;
+        case 1: // B.cond
+            fprintf(out, "if (");
+            emit_condition(out, instr->branch.cond);
+            fprintf(out, ") ");
+            if (static_target(image, target, pc)) {
+                fprintf(out, "goto L_%08" PRIx64 ";", target);
+            } else {
+                emit_exit(out, pc); // The interpreter takes the branch (or reports the stall)
+            }
+            break;
+        default: // BR
+            fprintf(out, "target = x%d; if (target == 0x%" PRIx64 ") ", instr->branch.xn, pc);
+            emit_exit(out, pc);
+            fprintf(out, " goto dispatch;");
+            break;
+    }
+}
+
+static void emit_instruction(FILE* out, const Image* image, uint32_t index) {
+    const DecodedInstruction* instr = &image->instrs[index];
+    uint64_t pc = (uint64_t)index * 4;
+
+    fprintf(out, "    ");
+    if (!translatable(image, instr, pc)) {
+        emit_exit(out, pc);
+    } else {
+        switch (instr->type) {
+            case DP_IMM: emit_dp_imm(out, instr); break;
+            case DP_REG: emit_dp_reg(out, instr); break;
+            case SDT: emit_sdt(out, instr, pc); break;
+            case LL:
+                fprintf(out, "x%d = aot_load%d(state->memory + 0x%" PRIx64 ");", instr->ll.rt, instr->sf ? 64 : 32,
+                        pc + ((int64_t)instr->ll.simm19 << 2));
+                break;
+            default: emit_branch(out, image, instr, pc); break;
+        }
+    }
+    fprintf(out, "\n");
+
+    // Falling off the translated code hands over to the interpreter
+    bool next_translated = index + 1 < image->word_count && image->reachable[index + 1];
+    if (translatable(image, instr, pc) && falls_through(instr) && !next_translated) {
+        fprintf(out, "    ");
+        emit_exit(out, pc + 4);
+        fprintf(out, "\n");
+    }
+}
+
+static void emit_translation(FILE* out, const Image* image, const char* image_name, const uint8_t* bytes,
+                             size_t size) {
+    fprintf(out, "// Translated from '%s' by translate. Do not edit.\n", image_name);
+    fprintf(out, "#include \"aot_runtime.h\"\n\n");
+
+    fprintf(out, "static const uint8_t image[%zu] = {", size ? size : 1);
+    if (size == 0) fprintf(out, "0");
+    for (size_t i = 0; i < size; i++) {
+        fprintf(out, "%s0x%02x,", i % 16 ? " " : "\n    ", bytes[i]);
+    }
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "#define CODE_WORDS %" PRIu32 "\n", image->word_count);
+    fprintf(out, "static const uint8_t code_map[%" PRIu32 "] = {", image->word_count / 8 + 1);
+    for (uint32_t byte = 0; byte <= image->word_count / 8; byte++) {
+        uint8_t bits = 0;
+        for (uint32_t bit = 0; bit < 8; bit++) {
+            uint32_t word = byte * 8 + bit;
+            if (word < image->word_count && image->reachable[word]) bits |= 1 << bit;
+        }
+        fprintf(out, "%s0x%02x,", byte % 16 ? " " : "\n    ", bits);
+    }
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "static void run_translated(ARMState* state) {\n");
+    for (int reg = 0; reg < 31; reg++) fprintf(out, "    uint64_t x%d = state->registers[%d];\n", reg, reg);
+    fprintf(out, "    bool N = state->nzcv & FLAG_N, Z = state->nzcv & FLAG_Z, C = state->nzcv & FLAG_C, V = state->nzcv & FLAG_V;\n");
+    fprintf(out, "    uint64_t target = state->pc;\n\n");
+
+    fprintf(out, "    (void)code_map;\n\n");
+
+    // Entry and BR targets
+    bool has_register_branch = false;
+    for (uint32_t index = 0; index < image->word_count; index++) {
+        const DecodedInstruction* instr = &image->instrs[index];
+        if (image->reachable[index] && instr->type == BRANCH && instr->branch.group == 3 &&
+            translatable(image, instr, (uint64_t)index * 4)) {
+            has_register_branch = true;
+        }
+    }
+    if (has_register_branch) fprintf(out, "dispatch:\n");
+    fprintf(out, "    switch (target) {\n");
+    for (uint32_t index = 0; index < image->word_count; index++) {
+        if (image->label[index]) {
+            fprintf(out, "        case 0x%" PRIx32 ": goto L_%08" PRIx32 ";\n", index * 4, index * 4);
+        }
+    }
+    fprintf(out, "        default: state->pc = target; goto leave;\n    }\n\n");
+
+    for (uint32_t index = 0; index < image->word_count; index++) {
+        if (!image->reachable[index]) continue;
+        if (image->label[index]) fprintf(out, "L_%08" PRIx32 ":\n", index * 4);
+        emit_instruction(out, image, index);
+    }
+
+    fprintf(out, "\nleave:\n");
+    for (int reg = 0; reg < 31; reg++) fprintf(out, "    state->registers[%d] = x%d;\n", reg, reg);
+    fprintf(out, "    state->nzcv = (N ? FLAG_N : 0) | (Z ? FLAG_Z : 0) | (C ? FLAG_C : 0) | (V ? FLAG_V : 0);\n}\n\n");
+
+    fprintf(out, "int main(int argc, char **argv) {\n");
+    fprintf(out, "    return aot_main(argc, argv, \"");
+    for (const char* c = image_name; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', out);
+        fputc(*c, out);
+    }
+    fprintf(out, "\", image, %zu, run_translated);\n}\n", size);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <image_in> <file_out.c>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) {
+        fprintf(stderr, "Error: Could not open input file '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    uint8_t* bytes = malloc(MEMORY_SIZE);
+    if (bytes == NULL) {
+        perror("Failed to allocate image buffer");
+        return EXIT_FAILURE;
+    }
+    size_t size = fread(bytes, 1, MEMORY_SIZE, in);
+    fclose(in);
+
+    Image image;
+    image.word_count = (uint32_t)(size / 4);
+    image.instrs = malloc(sizeof(DecodedInstruction) * (image.word_count + 1));
+    image.reachable = calloc(image.word_count + 1, 1);
+    image.label = calloc(image.word_count + 1, 1);
+    if (image.instrs == NULL || image.reachable == NULL || image.label == NULL) {
+        perror("Failed to allocate translation tables");
+        return EXIT_FAILURE;
+    }
+    uint32_t* words = malloc(sizeof(uint32_t) * (image.word_count + 1));
+    if (words == NULL) {
+        perror("Failed to allocate translation tables");
+        return EXIT_FAILURE;
+    }
+    for (uint32_t i = 0; i < image.word_count; i++) {
+        words[i] = (uint32_t)bytes[4 * i] | (uint32_t)bytes[4 * i + 1] << 8 |
+                   (uint32_t)bytes[4 * i + 2] << 16 | (uint32_t)bytes[4 * i + 3] << 24;
+    }
+    decode_block(words, image.word_count, image.instrs);
+    free(words);
+    discover(&image);
+
+    FILE* out = fopen(argv[2], "w");
+    if (!out) {
+        fprintf(stderr, "Error: Could not open output file '%s'\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    emit_translation(out, &image, argv[1], bytes, size);
+    fclose(out);
+
+    uint32_t translated = 0;
+    for (uint32_t i = 0; i < image.word_count; i++) translated += image.reachable[i];
+    fprintf(stderr, "Translated %" PRIu32 " of %" PRIu32 " words from '%s' into '%s'.\n", translated,
+            image.word_count, argv[1], argv[2]);
+
+    free(image.instrs);
+    free(image.reachable);
+    free(image.label);
+    free(bytes);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,259 @@
+#define _GNU_SOURCE // REG_EFL
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include "watchpoint.h"
+#include "decoder.h"
+#include "mem_branch_executor.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <ucontext.h>
+#define WATCHPOINTS_SUPPORTED
+#define TRAP_FLAG 0x100 // EFLAGS.TF: trap after the next instruction
+#endif
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+} WatchRange;
+
+static WatchRange ranges[MAX_WATCHPOINTS];
+static unsigned range_count;
+
+// Signal handlers only get the fault, so the machine being watched is kept here
+static ARMState* watched_state;
+static uintptr_t host_page_size;
+
+// Largest host page watchpoints work with
+#define MAX_HOST_PAGE (64 * 1024)
+
+// The store being single-stepped, and a copy of the protected pages it writes from
+// before it ran. It can straddle two of them.
+static struct {
+    bool active;
+    uint64_t address;
+    unsigned width;
+    uint8_t* pages[2];
+    unsigned page_count;
+} pending;
+static uint8_t saved_pages[2][MAX_HOST_PAGE];
+
+bool watchpoints_add(uint64_t address, uint64_t length) {
+    if (range_count == MAX_WATCHPOINTS || length == 0 || length > UINT64_MAX - address) return false;
+    ranges[range_count++] = (WatchRange){ .start = address, .end = address + length };
+    return true;
+}
+
+bool watchpoints_active(void) {
+    return range_count > 0;
+}
+
+#ifdef WATCHPOINTS_SUPPORTED
+// Host page holding guest memory byte offset
+static uint8_t* host_page(const ARMState* state, uint64_t offset) {
+    return (uint8_t*)((uintptr_t)(state->memory + offset) & ~(host_page_size - 1));
+}
+
+// Does the host page at page back part of a watched range?
+static bool page_watched(const ARMState* state, const uint8_t* page) {
+    for (unsigned i = 0; i < range_count; i++) {
+        if (page >= host_page(state, ranges[i].start) && page <= host_page(state, ranges[i].end - 1)) return true;
+    }
+    return false;
+}
+
+static void protect_ranges(const ARMState* state, int protection) {
+    for (unsigned i = 0; i < range_count; i++) {
+        uint8_t* first = host_page(state, ranges[i].start);
+        uint8_t* last = host_page(state, ranges[i].end - 1);
+        mprotect(first, (size_t)(last - first) + host_page_size, protection);
+    }
+}
+
+// Address and width of the store the guest is executing, from the instruction at
+// its PC (exact in the interpreter). Returns false if that is not a store.
+// The fault address is no substitute: a store running from an unwatched page into
+// a watched one faults at the start of the watched page.
+static bool current_store(const ARMState* state, uint64_t* address, unsigned* width) {
+    if (state->pc > state->memory_size - 4) return false;
+    uint32_t word = load_le32(&state->memory[state->pc]);
+    if (get_instruction_type(word) != SDT) return false;
+    DecodedInstruction instr = decode_instruction(word);
+    if (instr.sdt.L) return false;
+
+    // The store has already written back its base register: undo that on a copy
+    ARMState registers = *state;
+    if (instr.sdt.mode == PRE_INDEXED || instr.sdt.mode == POST_INDEXED) {
+        registers.registers[instr.sdt.xn] -= (uint64_t)(int64_t)instr.sdt.simm9;
+    }
+    *address = calculate_address(&registers, instr.sdt.mode, &instr);
+    *width = instr.sf ? 8 : 4;
+    return true;
+}
+
+// Little-endian value of width bytes at bytes
+static uint64_t read_value(const uint8_t* bytes, unsigned width) {
+    uint64_t value = 0;
+    for (unsigned i = 0; i < width; i++) value |= (uint64_t)bytes[i] << (8 * i);
+    return value;
+}
+
+// Guest memory as it was before the pending store, if the byte at offset was saved
+static const uint8_t* saved_byte(const ARMState* state, uint64_t offset) {
+    uint8_t* page = host_page(state, offset);
+    for (unsigned i = 0; i < pending.page_count; i++) {
+        if (pending.pages[i] == page) return &saved_pages[i][(state->memory + offset) - page];
+    }
+    return NULL;
+}
+
+static uint64_t old_value(const ARMState* state, uint64_t address, unsigned width) {
+    uint64_t value = 0;
+    for (unsigned i = 0; i < width; i++) {
+        const uint8_t* byte = saved_byte(state, address + i);
+        value |= (uint64_t)(byte ? *byte : state->memory[address + i]) << (8 * i);
+    }
+    return value;
+}
+
+// A store hit a protected page: save the page, let the store through, and trap
+// right after it
+static void on_fault(int signal_number, siginfo_t* info, void* context) {
+    (void)signal_number;
+    const ARMState* state = watched_state;
+    uint8_t* fault = info->si_addr;
+    uint8_t* page = (uint8_t*)((uintptr_t)fault & ~(host_page_size - 1));
+    if (fault < state->memory || fault >= state->memory + state->memory_size || !page_watched(state, page) ||
+        (pending.active && pending.page_count == 2)) {
+        signal(SIGSEGV, SIG_DFL); // A genuine crash: let it happen
+        return;
+    }
+
+    // The second page of a straddling store faults while the first is pending
+    if (!pending.active) {
+        pending.active = true;
+        if (!current_store(state, &pending.address, &pending.width)) {
+            pending.address = (uint64_t)(fault - state->memory);
+            pending.width = 4;
+        }
+        pending.page_count = 0;
+        // A store that starts on an unwatched page has not written any of it yet
+        // either; keep its old bytes too, for the value before
+        uint8_t* first = host_page(state, pending.address);
+        if (first != page && pending.address < state->memory_size) {
+            memcpy(saved_pages[0], first, host_page_size);
+            pending.pages[pending.page_count++] = first;
+        }
+    }
+    memcpy(saved_pages[pending.page_count], page, host_page_size);
+    pending.pages[pending.page_count++] = page;
+    mprotect(page, host_page_size, PROT_READ | PROT_WRITE);
+    ((ucontext_t*)context)->uc_mcontext.gregs[REG_EFL] |= TRAP_FLAG;
+}
+
+static char* put_text(char* out, const char* text) {
+    while (*text) *out++ = *text++;
+    return out;
+}
+
+// The low digits hex digits of value, like %0*x
+static char* put_hex(char* out, uint64_t value, unsigned digits) {
+    for (unsigned i = digits; i-- > 0;) *out++ = "0123456789abcdef"[(value >> (4 * i)) & 0xf];
+    return out;
+}
+
+static void report(const ARMState* state, const WatchRange* range, uint64_t address, unsigned width) {
+    // Formatted by hand and written with write: stdio, snprintf included, is not
+    // async-signal-safe. Guest addresses fit 8 digits (MAX_MEMORY_SIZE is 1GB).
+    char line[128];
+    char* out = put_text(line, "Watchpoint 0x");
+    out = put_hex(out, range->start, 8);
+    out = put_text(out, ": PC 0x");
+    out = put_hex(out, state->pc, 16);
+    *out++ = ' ';
+    *out++ = (char)('0' + width);
+    out = put_text(out, "-byte store to 0x");
+    out = put_hex(out, address, 8);
+    out = put_text(out, ": 0x");
+    out = put_hex(out, old_value(state, address, width), 2 * width);
+    out = put_text(out, " -> 0x");
+    out = put_hex(out, read_value(&state->memory[address], width), 2 * width);
+    *out++ = '\n';
+
+    ssize_t written = write(STDERR_FILENO, line, (size_t)(out - line));
+    (void)written; // Nothing to be done about a failure here
+}
+
+// The store went through: report the watched ranges it wrote, then protect its
+// pages again
+static void on_step(int signal_number, siginfo_t* info, void* context) {
+    (void)signal_number;
+    (void)info;
+    ((ucontext_t*)context)->uc_mcontext.gregs[REG_EFL] &= ~(greg_t)TRAP_FLAG;
+    if (!pending.active) return;
+
+    const ARMState* state = watched_state;
+    uint64_t start = pending.address, end = pending.address + pending.width;
+    if (end > state->memory_size) end = state->memory_size;
+    for (unsigned i = 0; i < range_count; i++) {
+        const WatchRange* range = &ranges[i];
+        if (start < range->end && range->start < end) {
+            report(state, range, start, (unsigned)(end - start));
+        }
+    }
+
+    for (unsigned i = 0; i < pending.page_count; i++) {
+        if (page_watched(state, pending.pages[i])) mprotect(pending.pages[i], host_page_size, PROT_READ);
+    }
+    pending.active = false;
+}
+#endif
+
+bool watchpoints_arm(ARMState* state) {
+    if (range_count == 0) return true;
+#ifndef WATCHPOINTS_SUPPORTED
+    (void)state;
+    fprintf(stderr, "Error: Watchpoints need an x86-64 Linux host\n");
+    return false;
+#else
+    for (unsigned i = 0; i < range_count; i++) {
+        if (ranges[i].end > state->memory_size) {
+            fprintf(stderr, "Error: Watchpoint 0x%" PRIx64 " lies outside guest memory\n", ranges[i].start);
+            return false;
+        }
+    }
+    host_page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+    if (host_page_size > MAX_HOST_PAGE) {
+        fprintf(stderr, "Error: Watchpoints need host pages of at most %dKB\n", MAX_HOST_PAGE / 1024);
+        return false;
+    }
+    watched_state = state;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    action.sa_sigaction = on_fault;
+    sigaction(SIGSEGV, &action, NULL);
+    action.sa_sigaction = on_step;
+    sigaction(SIGTRAP, &action, NULL);
+
+    protect_ranges(state, PROT_READ);
+    return true;
+#endif
+}
+
+void watchpoints_disarm(ARMState* state) {
+#ifdef WATCHPOINTS_SUPPORTED
+    if (range_count == 0 || watched_state != state) return;
+    protect_ranges(state, PROT_READ | PROT_WRITE);
+    signal(SIGSEGV, SIG_DFL);
+    signal(SIGTRAP, SIG_DFL);
+    watched_state = NULL;
+#else
+    (void)state;
+#endif
+}
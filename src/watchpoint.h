@@ -0,0 +1,36 @@
+#ifndef WATCHPOINT_H
+#define WATCHPOINT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "arm_state.h"
+
+// Data watchpoints (`emulate -w <address>[,<length>]`), for tracking down memory
+// corruption. The host pages backing a watched guest range are made read-only, so
+// the run goes at full speed until something stores into one of them. The SIGSEGV
+// handler then lets that one host instruction complete under single-stepping, puts
+// the protection back, and reports stores that touched a watched range: guest PC,
+// access width and the value before and after.
+//
+// Only x86-64 Linux hosts can single-step from a signal handler; elsewhere arming
+// watchpoints fails. The interpreter keeps state->pc exact and makes one host store
+// per guest store, so the emulator turns the JIT and loop idioms off while watching.
+
+#define MAX_WATCHPOINTS 8
+
+// Watches stores to [address, address + length). Returns false if the table is
+// full or length is 0. Add every watchpoint before arming them.
+bool watchpoints_add(uint64_t address, uint64_t length);
+
+// Any watchpoints added?
+bool watchpoints_active(void);
+
+// Protects the watched pages of state's memory and installs the signal handlers.
+// Call once the image is loaded (loading remaps memory). Returns false (after
+// reporting why) if a range lies outside memory or the host cannot watch.
+bool watchpoints_arm(ARMState* state);
+
+// Makes all of memory writable again and restores the default handlers
+void watchpoints_disarm(ARMState* state);
+
+#endif